@@ -42,9 +42,19 @@ bool bitmap::IsPassible (const location& loc) {
 }
 
 bool bitmap::IsPassible (int x, int y) { 
-	if (x <= max().x && y <= max().y && x >= 0 && y >= 0)
-        return Mono(x,y); 
-	return false;
+	return grid.IsPassible(x,y);
+}
+
+void bitmap::BuildPassabilityGrid() {
+	int width  = max().x+1;
+	int height = max().y+1;
+
+	grid.resize(width, height);
+	for (int y = 0; y < height; y ++) 
+	for (int x = 0; x < width;  x ++) {
+		if (Mono(x,y)) grid.Set(x,y,true);
+	}
+	grid.BuildNeighbourhoods();
 }
 
 bool bitmap::IsConnectedLatticeEdge (int x, int y) {    
@@ -222,6 +232,7 @@ location::Vector bitmap::GetLine (location a, location b)
 
 	location::Vector line;
 	location::Vector null(0);
+	if (!grid.Contains(a.x,a.y) || !grid.Contains(b.x,b.y)) return null;
 	line.push_back(a);
 
 	if (a == b) return line;
@@ -258,7 +269,7 @@ location::Vector bitmap::GetLine (location a, location b)
 			}
 			err += dy2;
 			pos.x += ix;
-			if (Mono(pos) == false) return null;			
+			if (grid(pos.x,pos.y) == false) return null;			
 			line.push_back(pos);
 		}
 	}
@@ -276,7 +287,7 @@ location::Vector bitmap::GetLine (location a, location b)
 			}
 			err += dx2;
 			pos.y += iy;
-			if (Mono(pos) == false) return null;
+			if (grid(pos.x,pos.y) == false) return null;
 			line.push_back(pos);
 		}
 	}
@@ -291,7 +302,11 @@ location::Vector bitmap::GetLine (location a, location b)
 // traversable.
 bool bitmap::HasLineOfSight(location a, location b) {
 
-	if (a == b) return Mono(a);
+	// Every cell of a line between two cells of the image is in the 
+	// image, so the grid is only bounds checked at the ends.
+	if (!grid.Contains(a.x,a.y) || !grid.Contains(b.x,b.y)) return false;
+
+	if (a == b) return grid(a.x,a.y);
 	
 	if (a > b) {
 		return HasLineOfSight(b,a);
@@ -323,11 +338,11 @@ bool bitmap::HasLineOfSight(location a, location b) {
 			if (err >= 0) {
 				err -= dx2;
 				pos.y += iy;
-				if (Mono(pos) == false) return false;
+				if (grid(pos.x,pos.y) == false) return false;
 			}
 			err += dy2;
 			pos.x += ix;
-			if (Mono(pos) == false) return false;			
+			if (grid(pos.x,pos.y) == false) return false;			
 		}
 	}
 	
@@ -339,11 +354,11 @@ bool bitmap::HasLineOfSight(location a, location b) {
 			if (err >= 0) {
 				err -= dy2;
 				pos.x += ix;
-				if (Mono(pos) == false) return false;
+				if (grid(pos.x,pos.y) == false) return false;
 			}
 			err += dx2;
 			pos.y += iy;
-			if (Mono(pos) == false) return false;
+			if (grid(pos.x,pos.y) == false) return false;
 		}
 	}
 
@@ -38,6 +38,7 @@
 
 #include "../location/location.hpp"
 #include "basic_bitmap.h"
+#include "passability_grid.h"
 
 class bitmap : public basic_bitmap {
 
@@ -48,6 +49,9 @@ protected:
     /* List of locations which lie on boundaries */
     location::Set boundaryLocation;
 
+    /* One bit per pixel of Mono(), taken by BuildPassabilityGrid() */
+    PassabilityGrid grid;
+
     // Find and stores obstacle boundary locations in this map.
     void FindBoundaries();
 
@@ -69,6 +73,18 @@ public:
     // locations in this map.
     location::Set GetBoundary();
 
+    ////////////////////////////////////////////////////////////////
+    // Packs the monochrome distillation of every pixel into this map's
+    // passability grid. Must be called once the image is loaded and 
+    // before any of the queries below; later changes to the pixels are
+    // not seen by them.
+    void BuildPassabilityGrid();
+
+    ////////////////////////////////////////////////////////////////
+    // The grid built by BuildPassabilityGrid(). Its cells within one
+    // of the image may be read without a bounds check.
+    const PassabilityGrid& Grid() const { return grid; }
+
     bool IsPassible (int x, int y);
     bool IsPassible (const location& loc);
 
@@ -52,6 +52,7 @@ bitmap* OpenBitmap(std::string inFilename,
 	// Load a 24 bit rgb bitmap
 	case BMP_RGB_24 : 	bmp = new rgb_bitmap(_distiller);
 						bmp->ReadBitmapFile( inFilename );
+						bmp->BuildPassabilityGrid();
 						return bmp;
 	#endif
 
@@ -59,6 +60,7 @@ bitmap* OpenBitmap(std::string inFilename,
 	// Load an 8 bit indexed rgb bitmap
 	case BMP_IDX_08 :	bmp = new indexed_bitmap(_distiller);
 						bmp->ReadBitmapFile( inFilename );
+						bmp->BuildPassabilityGrid();
 						return bmp;
 	#endif
 
@@ -66,6 +68,7 @@ bitmap* OpenBitmap(std::string inFilename,
 	// Load a 1 bit monochrome bitmap
 	case BMP_MON_01 :	bmp = new monochrome_bitmap();
 						bmp->ReadBitmapFile( inFilename );
+						bmp->BuildPassabilityGrid();
 						return bmp;
 	#endif
 
@@ -84,6 +87,7 @@ bitmap* OpenBitmap(std::string inFilename,
 	#ifdef _SDL_IMAGE_H
                         bmp = new rgb_bitmap(_distiller); 
 						bmp = ReadSdlFile(bmp, inFilename, _distiller); 
+						bmp->BuildPassabilityGrid();
 						return bmp;
 	#endif
                         strncpy(msg, 
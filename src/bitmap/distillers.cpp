@@ -159,10 +159,15 @@ bool LumDiff(location loc, bitmap* bmp) {
 }
 
 
+static int footprintRadius = 4; // 9x9 footprint
+
+void SetFootprintRadius(int radius) { footprintRadius = radius; }
+int FootprintRadius() { return footprintRadius; }
+
+
 bool Footprint(location loc, bitmap* bmp) {
     
-    const int footprint = 5; // 9x9 footprint
-    const int offset = footprint - 1;
+    const int offset = footprintRadius;
     const rgb rgbWhite(255,255,255);
     
     if (loc.x - offset < 0 || loc.x + offset > bmp->max().x) return false;
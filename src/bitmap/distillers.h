@@ -47,6 +47,13 @@ bool AvgLuminance(location loc, bitmap* bmp);
 
 bool LumDiff(location loc, bitmap* bmp);
 
+/** True where every pixel within FootprintRadius() of #loc#, in x and in y,
+	passes Luminance: where a vehicle that wide fits. False near the edges. */
 bool Footprint(location loc, bitmap* bmp);
 
+/** Sets the half width of Footprint's square window; 4, a 9x9 window, 
+	unless set. Set it before any bitmap is opened with Footprint. */
+void SetFootprintRadius(int radius);
+int FootprintRadius();
+
 #endif
@@ -0,0 +1,404 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "image_distillers.h"
+#include <vector>
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Every kernel works on planes of one value per pixel, laid out as the 
+// pixels are: column after column.
+typedef std::vector<unsigned char> Plane;
+typedef std::vector<float> FloatPlane;
+
+// The neighbour #offset# below or above #v#, reflected back inside 
+// [0,size) as the per-pixel distillers do.
+static inline int Below(int v, int offset) 
+	{ return (v-offset >= 0) ? v-offset : v+offset; }
+static inline int Above(int v, int offset, int size) 
+	{ return (v+offset < size) ? v+offset : v-offset; }
+
+#ifdef __SSE2__
+static inline __m128i Load(const unsigned char* p) 
+	{ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+static inline void Store(unsigned char* p, __m128i v) 
+	{ _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+#endif
+
+
+// Luminance of #c#, exactly as rgb_bitmap::Luminance finds it.
+static inline unsigned char PixelLuminance(const rgba& c) {
+	return ((c.r<<13) + (c.g<<14) + 3176*c.b)/(27752);
+}
+
+
+// Fills #lum# with the luminance of each of #count# pixels. The SSE2 path
+// divides in single precision, which is exact here: every numerator is 
+// below 2^23, and a quotient short of an integer k <= 255 falls short by
+// at least 1/27752, more than a float's spacing near k.
+static void LuminancePlane(const rgba* pixels, size_t count, 
+	unsigned char* lum) {
+
+	size_t i = 0;
+
+	#ifdef __SSE2__
+	const __m128i lowByte    = _mm_set1_epi32(0xFF);
+	const __m128i secondByte = _mm_set1_epi32(0xFF00);
+	const __m128i weights    = _mm_set1_epi32((16384 << 16) | 3176);
+	const __m128  divisor    = _mm_set1_ps(27752.f);
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i q[4];
+		for (int k = 0; k < 4; k ++) {
+			__m128i p = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(pixels + i + 4*k));
+
+			// b in the low and g in the high half of each pixel's lane, 
+			// so one multiply-add gives 3176 b + 16384 g.
+			__m128i bg = _mm_or_si128(_mm_and_si128(p, lowByte), 
+				_mm_slli_epi32(_mm_and_si128(p, secondByte), 8));
+			__m128i r  = _mm_and_si128(_mm_srli_epi32(p, 16), lowByte);
+			__m128i n  = _mm_add_epi32(_mm_madd_epi16(bg, weights), 
+				_mm_slli_epi32(r, 13));
+
+			q[k] = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(n), divisor));
+		}
+		Store(lum + i, _mm_packus_epi16(
+			_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3])));
+	}
+	#endif
+
+	for (; i < count; i ++) lum[i] = PixelLuminance(pixels[i]);
+}
+
+
+static void StoreMask(rgba* pixels, const Plane& mask) {
+	for (size_t i = 0; i < mask.size(); i ++) pixels[i].a = mask[i];
+}
+
+
+bool LuminanceImage(rgba* pixels, int width, int height) {
+	Plane lum((size_t)width*height);
+	if (lum.empty()) return true;
+
+	LuminancePlane(pixels, lum.size(), &lum[0]);
+	for (size_t i = 0; i < lum.size(); i ++) pixels[i].a = lum[i] > 170;
+	return true;
+}
+
+
+// AvgLuminance at row y of column c, between columns a and b.
+static inline unsigned char AvgLuminanceAt(const unsigned char* a, 
+	const unsigned char* c, const unsigned char* b, int ym, int y, int yp) {
+	unsigned sum = a[ym] + c[ym] + b[ym] + a[y] + b[y] + a[yp] + c[yp] + b[yp];
+	return sum/8 > 128;
+}
+
+
+bool AvgLuminanceImage(rgba* pixels, int width, int height) {
+	if (width < 2 || height < 2) return false;
+
+	size_t count = (size_t)width*height;
+	Plane lum(count), out(count);
+	LuminancePlane(pixels, count, &lum[0]);
+
+	for (int x = 0; x < width; x ++) {
+		const unsigned char* a = &lum[(size_t)Below(x,1)*height];
+		const unsigned char* c = &lum[(size_t)x*height];
+		const unsigned char* b = &lum[(size_t)Above(x,1,width)*height];
+		unsigned char* o = &out[(size_t)x*height];
+
+		o[0] = AvgLuminanceAt(a, c, b, 1, 0, 1);
+		o[height-1] = AvgLuminanceAt(a, c, b, height-2, height-1, height-2);
+
+		int y = 1;
+
+		#ifdef __SSE2__
+		// sum/8 > 128 exactly when sum > 1031.
+		const __m128i zero  = _mm_setzero_si128();
+		const __m128i limit = _mm_set1_epi16(1031);
+		const __m128i one   = _mm_set1_epi8(1);
+
+		for (; y + 16 <= height-1; y += 16) {
+			__m128i v[8] = { 
+				Load(a+y-1), Load(c+y-1), Load(b+y-1), Load(a+y), 
+				Load(b+y),   Load(a+y+1), Load(c+y+1), Load(b+y+1) };
+			__m128i lo = zero, hi = zero;
+			for (int k = 0; k < 8; k ++) {
+				lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v[k], zero));
+				hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v[k], zero));
+			}
+			Store(o+y, _mm_and_si128(one, _mm_packs_epi16(
+				_mm_cmpgt_epi16(lo, limit), _mm_cmpgt_epi16(hi, limit))));
+		}
+		#endif
+
+		for (; y < height-1; y ++) o[y] = AvgLuminanceAt(a, c, b, y-1, y, y+1);
+	}
+
+	StoreMask(pixels, out);
+	return true;
+}
+
+
+bool LumDiffImage(rgba* pixels, int width, int height) {
+	size_t count = (size_t)width*height;
+	if (count == 0) return true;
+
+	Plane lum(count), out(count);
+	LuminancePlane(pixels, count, &lum[0]);
+
+	for (int x = 0; x < width; x ++) {
+		const unsigned char* m = &lum[(size_t)((x > 0) ? x-1 : x)*height];
+		const unsigned char* c = &lum[(size_t)x*height];
+		unsigned char* o = &out[(size_t)x*height];
+
+		int y = 0;
+
+		#ifdef __SSE2__
+		const __m128i limit = _mm_set1_epi8(32);
+		const __m128i one   = _mm_set1_epi8(1);
+
+		for (; y + 16 <= height; y += 16) {
+			__m128i p = Load(c+y), q = Load(m+y);
+			__m128i d = _mm_or_si128(_mm_subs_epu8(p,q), _mm_subs_epu8(q,p));
+			Store(o+y, _mm_and_si128(one, 
+				_mm_cmpeq_epi8(_mm_min_epu8(d, limit), d)));
+		}
+		#endif
+
+		for (; y < height; y ++) o[y] = abs(c[y] - m[y]) <= 32;
+	}
+
+	StoreMask(pixels, out);
+	return true;
+}
+
+
+bool FootprintImage(rgba* pixels, int width, int height) {
+	const int radius = FootprintRadius();
+	const unsigned area = (unsigned)(2*radius + 1)*(2*radius + 1);
+
+	size_t count = (size_t)width*height;
+	if (count == 0) return true;
+
+	Plane lum(count), out(count, 0);
+	LuminancePlane(pixels, count, &lum[0]);
+
+	// Summed-area table, (width+1) by (height+1): sat[x][y] counts the light
+	// pixels in [0,x) by [0,y). Sums wrap harmlessly in unsigned arithmetic.
+	const size_t satHeight = height + 1;
+	std::vector<unsigned> sat((size_t)(width+1)*satHeight, 0);
+
+	for (int x = 0; x < width; x ++) {
+		const unsigned char* l = &lum[(size_t)x*height];
+		const unsigned* left = &sat[(size_t)x*satHeight];
+		unsigned* s = &sat[(size_t)(x+1)*satHeight];
+		unsigned column = 0;
+		for (int y = 0; y < height; y ++) {
+			column += l[y] > 170;
+			s[y+1] = left[y+1] + column;
+		}
+	}
+
+	// A pixel passes when its whole window is light; windows that would
+	// leave the image fail, as in Footprint.
+	for (int x = radius; x < width - radius; x ++) {
+		const unsigned* lo = &sat[(size_t)(x-radius)*satHeight];
+		const unsigned* hi = &sat[(size_t)(x+radius+1)*satHeight];
+		unsigned char* o = &out[(size_t)x*height];
+
+		for (int y = radius; y < height - radius; y ++) {
+			unsigned light = hi[y+radius+1] - lo[y+radius+1] 
+				- hi[y-radius] + lo[y-radius];
+			o[y] = light == area;
+		}
+	}
+
+	StoreMask(pixels, out);
+	return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// ColorVariation
+
+// Odd minimax polynomial for atan on [-1,1]; larger arguments use 
+// atan(x) = pi/2 - atan(1/x).
+static const float ATAN_C1  =  0.99997726f;
+static const float ATAN_C3  = -0.33262347f;
+static const float ATAN_C5  =  0.19354346f;
+static const float ATAN_C7  = -0.11643287f;
+static const float ATAN_C9  =  0.05265332f;
+static const float ATAN_C11 = -0.01172120f;
+static const float HALF_PI  =  1.57079632679f;
+
+float FastAtan(float x) {
+	float a = fabsf(x);
+	bool big = a > 1.f;
+	float t = big ? 1.f/a : a;
+	float z = t*t;
+	float p = t*(ATAN_C1 + z*(ATAN_C3 + z*(ATAN_C5 + z*(ATAN_C7 + 
+		z*(ATAN_C9 + z*ATAN_C11)))));
+	if (big) p = HALF_PI - p;
+	return (x < 0) ? -p : p;
+}
+
+#ifdef __SSE2__
+static inline __m128 FastAtan4(__m128 x) {
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	const __m128 one = _mm_set1_ps(1.f);
+
+	__m128 sign = _mm_and_ps(x, signMask);
+	__m128 a    = _mm_andnot_ps(signMask, x);
+	__m128 big  = _mm_cmpgt_ps(a, one);
+	__m128 t    = _mm_or_ps(_mm_and_ps(big, _mm_div_ps(one, a)), 
+		_mm_andnot_ps(big, a));
+	__m128 z    = _mm_mul_ps(t, t);
+
+	__m128 p = _mm_set1_ps(ATAN_C11);
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(ATAN_C9));
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(ATAN_C7));
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(ATAN_C5));
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(ATAN_C3));
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(ATAN_C1));
+	p = _mm_mul_ps(p, t);
+
+	p = _mm_or_ps(_mm_and_ps(big, _mm_sub_ps(_mm_set1_ps(HALF_PI), p)),
+		_mm_andnot_ps(big, p));
+	return _mm_or_ps(p, sign);
+}
+#endif
+
+
+// One of ColorVariation's four opposite pairs of neighbours.
+static inline float PairVariation(const float* phi, const float* theta, 
+	size_t i, size_t j) {
+	float dp = phi[i] - phi[j];
+	float dt = theta[i] - theta[j];
+	return sqrtf(dp*dp + dt*dt);
+}
+
+
+bool ColorVariationImage(rgba* pixels, int width, int height) {
+	const int offset = 6;           // as ColorVariation
+	const float threshold = 0.25f;
+
+	if (width < 2*offset || height < 2*offset) return false;
+
+	// ColorVariation's angles only depend on the ratios of the pixel's 
+	// channels, so each pixel's are found once, not once per neighbour.
+	size_t count = (size_t)width*height;
+	FloatPlane phi(count), theta(count);
+	size_t i = 0;
+
+	#ifdef __SSE2__
+	const __m128i lowByte = _mm_set1_epi32(0xFF);
+	for (; i + 4 <= count; i += 4) {
+		__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels+i));
+		__m128 b = _mm_cvtepi32_ps(_mm_and_si128(p, lowByte));
+		__m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 8), lowByte));
+		__m128 r = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p,16), lowByte));
+		_mm_storeu_ps(&phi[i],   FastAtan4(_mm_div_ps(b, g)));
+		_mm_storeu_ps(&theta[i], FastAtan4(_mm_div_ps(r, g)));
+	}
+	#endif
+
+	for (; i < count; i ++) {
+		float g = pixels[i].g;
+		phi[i]   = FastAtan(pixels[i].b / g);
+		theta[i] = FastAtan(pixels[i].r / g);
+	}
+
+	Plane out(count);
+
+	for (int x = 0; x < width; x ++) {
+		size_t cm = (size_t)Below(x,offset)*height;
+		size_t cx = (size_t)x*height;
+		size_t cp = (size_t)Above(x,offset,width)*height;
+		unsigned char* o = &out[cx];
+
+		for (int y = 0; y < height; y ++) {
+
+			#ifdef __SSE2__
+			// Between the reflected rows, four at a time.
+			if (y == offset) for (; y + 4 <= height-offset; y += 4) {
+				__m128 v = _mm_setzero_ps();
+				size_t from[4] = { cm+y-offset, cx+y-offset, cp+y-offset, cm+y };
+				size_t to[4]   = { cp+y+offset, cx+y+offset, cm+y+offset, cp+y };
+				for (int k = 0; k < 4; k ++) {
+					__m128 dp = _mm_sub_ps(_mm_loadu_ps(&phi[from[k]]), 
+						_mm_loadu_ps(&phi[to[k]]));
+					__m128 dt = _mm_sub_ps(_mm_loadu_ps(&theta[from[k]]), 
+						_mm_loadu_ps(&theta[to[k]]));
+					v = _mm_add_ps(v, _mm_sqrt_ps(_mm_add_ps(
+						_mm_mul_ps(dp,dp), _mm_mul_ps(dt,dt))));
+				}
+				v = _mm_add_ps(v, v);
+
+				// NaN angles, from black pixels, compare false: passible.
+				int light = ~_mm_movemask_ps(_mm_cmpge_ps(v, 
+					_mm_set1_ps(threshold)));
+				for (int k = 0; k < 4; k ++) o[y+k] = (light >> k) & 1;
+			}
+			#endif
+
+			int ym = Below(y,offset);
+			int yp = Above(y,offset,height);
+
+			// Each pair is met twice in ColorVariation's sum, once each way.
+			float v = 2.f*(
+				PairVariation(&phi[0], &theta[0], cm+ym, cp+yp) +
+				PairVariation(&phi[0], &theta[0], cx+ym, cx+yp) +
+				PairVariation(&phi[0], &theta[0], cp+ym, cm+yp) +
+				PairVariation(&phi[0], &theta[0], cm+y,  cp+y));
+			o[y] = !(v >= threshold);
+		}
+	}
+
+	StoreMask(pixels, out);
+	return true;
+}
+
+
+ImageDistiller WholeImage(Distiller distiller) {
+	if (distiller == &Luminance)      return &LuminanceImage;
+	if (distiller == &AvgLuminance)   return &AvgLuminanceImage;
+	if (distiller == &ColorVariation) return &ColorVariationImage;
+	if (distiller == &LumDiff)        return &LumDiffImage;
+	if (distiller == &Footprint)      return &FootprintImage;
+	return 0;
+}
@@ -0,0 +1,66 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_DISTILLERS_H
+#define IMAGE_DISTILLERS_H
+
+#include "distillers.h"
+#include "rgba.h"
+
+/** Distills a whole image at once, setting each pixel's a to what its 
+	per-pixel Distiller gives. #pixels# holds the image a column at a 
+	time, #height# pixels to a column, as rgb_bitmap stores it. Returns 
+	false, leaving the image alone, for an image too small for the kernel;
+	the per-pixel distiller is then to be used instead. */
+typedef bool (*ImageDistiller)(rgba* pixels, int width, int height);
+
+/** The whole-image version of #distiller#, or 0 if it has none. */
+ImageDistiller WholeImage(Distiller distiller);
+
+bool LuminanceImage(rgba* pixels, int width, int height);
+
+bool AvgLuminanceImage(rgba* pixels, int width, int height);
+
+/** Uses FastAtan, so a pixel whose variation is within a few millionths 
+	of the threshold may come out differently from ColorVariation. */
+bool ColorVariationImage(rgba* pixels, int width, int height);
+
+bool LumDiffImage(rgba* pixels, int width, int height);
+
+/** Looks each window up in a summed-area table, so the cost per pixel does
+	not grow with FootprintRadius(). */
+bool FootprintImage(rgba* pixels, int width, int height);
+
+/** atanf to within 2e-6 radians, by an odd polynomial of degree 11. */
+float FastAtan(float x);
+
+#endif
@@ -73,7 +73,7 @@ class indexed_bitmap : public bitmap {
 		/** @name Operators **/
 		//@{
 
-		typedef std::vector<indexed>::iterator indexed_iterator;
+		typedef matrix<indexed>::y_iterator indexed_iterator;
 		indexed_iterator operator[] (const location& loc);
 		indexed_iterator operator() (int x, int y);
 		indexed_iterator iterator (int x, int y);
@@ -86,15 +86,8 @@ bitmap* ReadSdlFile( bitmap* bm, std::string filename, Distiller _distiller )
 			
 	}	}
 	
-	for(int x = 0; x < width;  x++) {
-	for(int y = 0; y < height; y++) {
-		
-		rgba rgbq(bm->GetPixel(x,y));
-		location loc(x,y);
-		rgbq.a = _distiller(loc,bm);
-		bm->SetPixel(x,y,rgbq);
-
-	}	}
+	// bm was made with _distiller by the caller.
+	((rgb_bitmap*)bm)->Distill();
 
 	SDL_UnlockSurface( image );
 	SDL_FreeSurface( image );
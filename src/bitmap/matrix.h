@@ -35,115 +35,204 @@
 
 #include <sstream>
 #include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
 #include "../location/location.hpp"
 
+// Alignment, in bytes, of every matrix's buffer: one cache line.
+#define MATRIX_ALIGNMENT 64
+
+////////////////////////////////////////////////////////////////////////////////
+/** A width by height array of T in a single contiguous, cache line aligned
+	buffer. Element (x,y) is at x*height + y, so each x is one row of 
+	height elements and rows follow one another without padding.
+
+	GetValue and SetValue are bounds checked; Value and operator[] are not
+	and are meant for hot paths whose indices are known to be valid.
+
+	Attach makes the matrix a view of memory it does not own, such as a 
+	mapped file; the matrix then never frees or destroys those elements.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
 template<typename T>
 class matrix {
 
 	public:
-		typedef std::vector<std::vector<T> > t_matrix;
-		typedef typename std::vector<T>::iterator y_iterator;
-		typedef typename std::vector<std::vector<T> >::iterator x_iterator;
+		typedef T* y_iterator;
+		typedef T* x_iterator;
 			
 	protected:
 		bool initialized;
 		location _max;
 	
-		t_matrix myMatrix;
+		T* buffer;
+		int width;
+		int height;
+		bool owner;
+
+	private:
+		void allocate (int _width, int _height, const T& initial_value) {
+			release();
+			width  = _width;
+			height = _height;
+			_max.x = width-1;
+			_max.y = height-1;
+			initialized = true;
+			owner = true;
+
+			if (size() == 0) return;
+
+			void* p = 0;
+			if (posix_memalign(&p, MATRIX_ALIGNMENT, size()*sizeof(T)) != 0)
+				throw std::bad_alloc();
+			buffer = static_cast<T*>(p);
+			std::uninitialized_fill(buffer, buffer + size(), initial_value);
+		}
+
+		void release () {
+			if (buffer && owner) {
+				for (size_t i = 0; i < size(); i ++) buffer[i].~T();
+				free(buffer);
+			}
+			buffer = 0;
+			width = height = 0;
+			owner = true;
+		}
 		
 	public:
-		matrix() { initialized = false; }
+		matrix() : initialized(false), buffer(0), width(0), height(0), 
+			owner(true) { }
 		
-		matrix(matrix *m) {
-			*this = *m;
-		}
+		matrix(matrix *m) : initialized(false), buffer(0), width(0), height(0),
+			owner(true) { *this = *m; }
+	
+		matrix(const matrix& m) : 
+			initialized(false), buffer(0), width(0), height(0), owner(true)
+			{ *this = m; }
 	
-		matrix(int width, int height) {
+		matrix(int width, int height) : 
+			buffer(0), width(0), height(0), owner(true) {
 			resize ( width, height );
 		}
 		
-		matrix(int width, int height, T initial_value) {
+		matrix(int width, int height, T initial_value) : 
+			buffer(0), width(0), height(0), owner(true) {
 			resize ( width, height, initial_value );
 		}
 
-		matrix& operator= (matrix *m) {
-			myMatrix = m->myMatrix;
-			initialized = m->initialized;
-			_max = m->max;
+		~matrix() { release(); }
+
+		matrix& operator= (const matrix& m) {
+			if (&m == this) return *this;
+			if (m.buffer) {
+				allocate(m.width, m.height, T());
+				std::copy(m.buffer, m.buffer + size(), buffer);
+			}
+			else release();
+			initialized = m.initialized;
+			_max = m._max;
+			return *this;
 		}			
 
-//		y_iterator operator[] (const location& loc) {
-//			y_iterator yit = myMatrix[loc.x].begin() + loc.y;
-//			return yit;
-//		}
+		matrix& operator= (matrix *m) { return *this = *m; }
 
-        std::vector<T>& operator[] (size_t x) { return myMatrix[x]; }
+		/** Row #x#; element y of it is (#x#,y). Unchecked. */
+		T* operator[] (size_t x) { return buffer + x*height; }
+		const T* operator[] (size_t x) const { return buffer + x*height; }
         
         bool operator==(matrix<T>& Q) {
-            for (int i = 0; i <= _max.x; i ++)
-                if (!(myMatrix[i] == Q.myMatrix[i])) return false;
-            
-            return true;
+            if (width != Q.width || height != Q.height) return false;
+            const T* a = buffer;
+            const T* b = Q.buffer;
+            return std::equal(a, a + size(), b);
         }
 
 		// to do: can't extract data from the matrix with this; can only set
 		// data.
 		y_iterator operator() (int x, int y) {
-			y_iterator yit = myMatrix[x].begin()+y; 
-			return yit;
+			return buffer + (size_t)x*height + y;
 		}
 			
 		y_iterator operator() (location loc) {
-			y_iterator yit = myMatrix[loc.x].begin()+loc.y; 
-			return yit;
+			return buffer + (size_t)loc.x*height + loc.y;
 		}
 
+		/** Element (#x#,#y#), without a bounds check. */
+		T& Value(int x, int y) { return buffer[(size_t)x*height + y]; }
+		const T& Value(int x, int y) const 
+			{ return buffer[(size_t)x*height + y]; }
+
 		T GetValue(int x, int y) throw (std::out_of_range) { 
-			try {return myMatrix.at(x).at(y);}
-			catch (std::out_of_range e) { throw e; }
+			CheckRange(x,y);
+			return Value(x,y);
 		}
 		
 		void SetValue(int x, int y, T _val) throw (std::out_of_range) { 
-			try {myMatrix.at(x).at(y) = _val;}
-			catch (std::out_of_range e) { throw e; }
+			CheckRange(x,y);
+			Value(x,y) = _val;
 		}
 
-		// to do: how to I make this appropriately mutable?
+		void CheckRange(int x, int y) const throw (std::out_of_range) {
+			if ((unsigned)x >= (unsigned)width || 
+				(unsigned)y >= (unsigned)height)
+				throw std::out_of_range("matrix");
+		}
+		
+		/** Discards the matrix's contents, leaving #width# by #height# 
+			default constructed elements. */
 		void resize (int width, int height) {
-			myMatrix.resize(width, std::vector<T>(height));
-			_max.x=width-1;
-			_max.y=height-1;
-			initialized = true;
+			allocate(width, height, T());
 		}
 		
+		/** Discards the matrix's contents, leaving #width# by #height# 
+			copies of #initial_value#. */
 		void resize (int width, int height, T initial_value) {
-			myMatrix.resize(width, std::vector<T>(height, initial_value));
-			_max.x=width-1;
-			_max.y=height-1;
+			allocate(width, height, initial_value);
+		}
+		
+		/** Discards the matrix's contents and makes it a #width# by 
+			#height# view of #data#, which must outlive the matrix or the 
+			next resize. Copies of the matrix own their elements. */
+		void Attach (T* data, int width, int height) {
+			release();
+			buffer = data;
+			this->width  = width;
+			this->height = height;
+			_max.x = width-1;
+			_max.y = height-1;
 			initialized = true;
+			owner = false;
 		}
 		
 		int max_x() { return _max.x; }
 		int max_y() { return _max.y; }
 		location max() { return _max; }
 
-		x_iterator begin() { return myMatrix.begin(); }
-		x_iterator end()   { return myMatrix.end();   }
+		x_iterator begin() { return buffer; }
+		x_iterator end()   { return buffer + size(); }
 		
-		y_iterator begin(int _x) { return myMatrix.at(_x).begin(); }
-		y_iterator end  (int _x) { return myMatrix.at(_x).end();   }
+		y_iterator begin(int _x) { CheckRange(_x,0); return (*this)[_x]; }
+		y_iterator end  (int _x) { CheckRange(_x,0); return (*this)[_x+1]; }
 		
 		int Height() { return _max.y+1; }
 		
-        char* CharCast() {
-            char* chars = new char[byte_size()];
-            for (int r=0; r < Height(); r ++)
-                memcpy(&chars[r*row_size()], &myMatrix[r][0], row_size());
-            return chars;
-        }
+		/** Number of elements. */
+		size_t size() const { return (size_t)width*height; }
         
-        size_t byte_size() { return Height()*Height()*sizeof(T); }
-        size_t row_size() { return Height()*sizeof(T); }
+		/** The elements' bytes, row after row, byte_size() of them. This is
+			the matrix's own buffer, not a copy. */
+		const char* CharCast() const 
+			{ return reinterpret_cast<const char*>(buffer); }
+		char* CharCast() { return reinterpret_cast<char*>(buffer); }
+		
+        size_t byte_size() { return size()*sizeof(T); }
+        size_t row_size() { return height*sizeof(T); }
 };
 
 #endif
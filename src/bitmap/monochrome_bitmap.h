@@ -65,7 +65,7 @@ class monochrome_bitmap : public bitmap {
 		/** @name Operators **/
 		//@{
 
-		typedef std::vector<basic_bitmap::mono>::iterator mono_iterator;
+		typedef matrix<basic_bitmap::mono>::y_iterator mono_iterator;
 		mono_iterator operator[] (const location& loc);
 		mono_iterator operator() (int x, int y);
 		mono_iterator iterator (int x, int y);
@@ -0,0 +1,66 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "passability_grid.h"
+
+void PassabilityGrid::resize(int _width, int _height) {
+	width  = _width;
+	height = _height;
+
+	// One border column either side of the image.
+	stride = (width + 2 + 63) / 64;
+
+	bits.assign((size_t)stride * (height + 2), 0);
+	hoods.clear();
+}
+
+void PassabilityGrid::BuildNeighbourhoods() {
+	hoods.resize((size_t)(width + 2) * (height + 2));
+	unsigned char* code = hoods.empty() ? 0 : &hoods[0];
+
+	for (int y = -1; y <= height; y ++) {
+		// Bits 0, 1 and 2 of each window hold columns x-1, x and x+1 of
+		// the rows above, at and below y.
+		unsigned above = Bordered(-1,y-1) << 2;
+		unsigned at    = Bordered(-1,y)   << 2;
+		unsigned below = Bordered(-1,y+1) << 2;
+
+		for (int x = -1; x <= width; x ++) {
+			above = (above >> 1) | (Bordered(x+1,y-1) << 2);
+			at    = (at    >> 1) | (Bordered(x+1,y)   << 2);
+			below = (below >> 1) | (Bordered(x+1,y+1) << 2);
+
+			*code++ = (unsigned char)(above | 
+				((at & 1) ? W : 0) | ((at & 4) ? E : 0) | (below << 5));
+		}
+	}
+}
@@ -0,0 +1,151 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PASSABILITY_GRID_H
+#define PASSABILITY_GRID_H
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////////////
+/**	One bit per pixel of a bitmap's monochrome distillation, set where the 
+	pixel is passible. Rows run along x and are padded to whole 64-bit 
+	words. The image is surrounded by a one cell border of impassible cells,
+	so any location within one cell of the image may be read without a 
+	bounds check.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class PassabilityGrid {
+
+	public:
+		typedef uint64_t word;
+
+		/** Bits of a neighbourhood code, one per cell around (x,y). */
+		enum Neighbour { 
+			NW = 1,  N = 2,  NE = 4,    // (x-1,y-1) (x,y-1) (x+1,y-1)
+			W  = 8,          E  = 16,   // (x-1,y)           (x+1,y)
+			SW = 32, S = 64, SE = 128   // (x-1,y+1) (x,y+1) (x+1,y+1)
+		};
+
+	private:
+		int width;
+		int height;
+		int stride;                 // words per row, border included
+		std::vector<word> bits;     // (height+2) rows, starting at y = -1
+		
+		// One neighbourhood code per cell of the image and its border,
+		// (width+2) to a row, starting at (-1,-1).
+		std::vector<unsigned char> hoods;
+
+		// (#x#,#y#) as operator(), but false outside the border too.
+		bool Bordered(int x, int y) const {
+			return (unsigned)(x+1) < (unsigned)(width+2) &&
+				   (unsigned)(y+1) < (unsigned)(height+2) && (*this)(x,y);
+		}
+
+	public:
+
+		/////////////////////////////////////////////////////
+		/** @name Constructors **/
+		//@{
+
+		PassabilityGrid() : width(0), height(0), stride(0) { }
+
+		/** A width by height grid of impassible cells. */
+		PassabilityGrid(int _width, int _height) { resize(_width, _height); }
+
+		//@}
+
+
+		/////////////////////////////////////////////////////
+		/** @name Public Members **/
+		//@{
+
+		/** Discards the grid's contents; every cell becomes impassible. */
+		void resize(int _width, int _height);
+
+		int GetWidth()  const { return width;  }
+		int GetHeight() const { return height; }
+
+		/** Number of 64-bit words in a row, border cells included. */
+		int GetStride() const { return stride; }
+
+		/** Marks (#x#,#y#) passible or impassible. 
+			@precondition (#x#,#y#) is inside the image. */
+		void Set(int x, int y, bool passible) {
+			word& w = bits[(y+1)*stride + ((x+1) >> 6)];
+			word  b = (word)1 << ((x+1) & 63);
+			if (passible) w |= b; else w &= ~b;
+		}
+
+		/** True if (#x#,#y#) is passible. No bounds check.
+			@precondition -1 <= #x# <= width and -1 <= #y# <= height. */
+		bool operator() (int x, int y) const {
+			return (bits[(y+1)*stride + ((x+1) >> 6)] >> ((x+1) & 63)) & 1;
+		}
+
+		/** True if (#x#,#y#) is inside the image. */
+		bool Contains(int x, int y) const {
+			return (unsigned)x < (unsigned)width && 
+				   (unsigned)y < (unsigned)height;
+		}
+
+		/** True if (#x#,#y#) is passible; false anywhere off the image. */
+		bool IsPassible(int x, int y) const {
+			return Contains(x,y) && (*this)(x,y);
+		}
+
+		/** The words of row #y#. Bit i of the row holds x = i-1. 
+			@precondition -1 <= #y# <= height. */
+		const word* Row(int y) const { return &bits[(y+1)*stride]; }
+
+		/** Finds every cell's neighbourhood code from the cells set so 
+			far. Must be called again after any later Set(). */
+		void BuildNeighbourhoods();
+
+		/** The passability of the eight cells around (#x#,#y#), as a sum 
+			of Neighbour bits. Cells off the image count as impassible.
+			@precondition BuildNeighbourhoods() has been called. */
+		unsigned char Neighbourhood(int x, int y) const {
+			if ((unsigned)(x+1) >= (unsigned)(width+2) || 
+				(unsigned)(y+1) >= (unsigned)(height+2)) return 0;
+			return hoods[(size_t)(y+1)*(width+2) + (x+1)];
+		}
+
+		//@}
+};
+
+#endif
@@ -32,6 +32,7 @@
 
 #include <assert.h>
 #include "rgb_bitmap.h"
+#include "image_distillers.h"
 #include "../std_extensions/set_operations.h"
 
 rgb_bitmap::rgb_bitmap() { }
@@ -97,7 +98,8 @@ rgb_bitmap::rgba_iterator
 //
 
 basic_bitmap::mono rgb_bitmap::Mono (const location& loc) {
-	return data.GetValue(loc.x,loc.y).a;
+	assert(loc.x <= max().x && loc.y <= max().y);
+	return data.Value(loc.x,loc.y).a;
 }
 
 /* From http://www.freescale.com/webapp/sps/site/overview.jsp?
@@ -109,7 +111,8 @@ basic_bitmap::mono rgb_bitmap::Mono (const location& loc) {
 	Cr = [(14345 R - 12045 G -  2300 B)/32768] + 128
 */
 basic_bitmap::mono rgb_bitmap::Mono (int x, int y) {
-	return data.GetValue(x,y).a;
+	assert(x <= max().x && y <= max().y);
+	return data.Value(x,y).a;
 }
 
 
@@ -120,7 +123,8 @@ unsigned char rgb_bitmap::Luminance(location loc) {
 
 // returns the luminance (Y) at location x,y
 unsigned char rgb_bitmap::Luminance(int x, int y) {
-	rgb c = data.GetValue(x, y); 
+	assert(x <= max().x && y <= max().y);
+	rgb c = data.Value(x, y); 
 	return ((c.r<<13) + (c.g<<14) + 3176*c.b)/(27752);
 }
 
@@ -154,7 +158,7 @@ void rgb_bitmap::ReadBitmapFile (const std::string &fileName)
 	int& y = loc.y;
 
 	for (; y < height; y ++) {
-	for (; x <  width; x ++) {
+	for (x = 0; x <  width; x ++) {
 
 		int bufferOffset = (int)((x*bytesPerSample)+(y*paddedByteWidth));
 		const int BLUE = 0;
@@ -173,12 +177,21 @@ void rgb_bitmap::ReadBitmapFile (const std::string &fileName)
 //		blue.add(rgbt.r);
 
 		SetPixel(x,y,rgbt);
-        distiller(loc,this);
-		SetPixel(x,y,rgbt);
 
 	}	}
 
 	delete[] pixelBuffer;
+	Distill();
+}
+
+void rgb_bitmap::Distill () {
+	ImageDistiller whole = WholeImage(distiller);
+	if (whole && whole(data.begin(), GetWidth(), GetHeight())) return;
+
+	location loc(0,0);
+	for (loc.x = 0; loc.x < GetWidth();  loc.x ++)
+	for (loc.y = 0; loc.y < GetHeight(); loc.y ++)
+		data.Value(loc.x,loc.y).a = distiller(loc,this);
 }
 
 //===================================================================
@@ -85,7 +85,7 @@ class rgb_bitmap : public bitmap {
 //		rgb_triple_iterator operator() (int x, int y);
 //		rgb_triple_iterator iterator (int x, int y);
 
-		typedef std::vector<rgba>::iterator rgba_iterator;
+		typedef matrix<rgba>::y_iterator rgba_iterator;
 		rgba_iterator operator[] (const location& loc);
 		rgba_iterator operator() (int x, int y);
 		rgba_iterator iterator (int x, int y);
@@ -132,6 +132,14 @@ class rgb_bitmap : public bitmap {
 		void WriteBitmapFile (const std::string &fileName)
 			throw (catch_all_exception);
 
+		/** Sets every pixel's a to its distillation, a whole image at a time
+			where the distiller has a whole-image version (see 
+			image_distillers.h), else pixel by pixel. Called once the pixels
+			are read.
+			@memo
+		*/
+		void Distill ();
+
 		// to do: find a way to impliment these virtually in basic_bitmap
 		// or find a way to access these methods polymophically.
 		/** Return pointer to pixel map */
@@ -0,0 +1,475 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AdjacencyGraph.h"
+#include "VisibilitySweep.h"
+#include <iostream>
+#include <utility>
+#include <pthread.h>
+
+// A row of the upper triangle: far vertex ids, ascending, and weights.
+typedef std::vector<int> RowOther;
+typedef std::vector<undirectedLength> RowWeight;
+
+
+//===================================================================
+// ReportDisagreements(): Compares vertex v's edges found by Bresenham
+//		with those found by the visibility sweep, writing each edge 
+//		only one of them has to std::cerr.
+// Returns: the number of such edges.
+//
+static size_t ReportDisagreements
+(location v, const RowOther& bresenham, const RowOther& swept, 
+const location::Vector& verts)
+{
+    size_t count = 0;
+
+    for (RowOther::const_iterator i = bresenham.begin(); 
+            i != bresenham.end(); i++) {
+        if (!std::binary_search(swept.begin(), swept.end(), *i)) {
+            std::cerr << "Sweep missed edge " << v << " - " 
+                << verts[*i] << "\n";
+            count ++;
+        }
+    }
+
+    for (RowOther::const_iterator i = swept.begin(); i != swept.end(); i++) {
+        if (!std::binary_search(bresenham.begin(), bresenham.end(), *i)) {
+            std::cerr << "Sweep added edge " << v << " - " 
+                << verts[*i] << "\n";
+            count ++;
+        }
+    }
+
+    return count;
+}
+
+
+// Vertices claimed by an edge weight worker at a time. Rows near the 
+// start of the vertex set are much longer than those near its end, so 
+// work is handed out in small pieces rather than split evenly up front.
+#define EDGE_WEIGHT_CHUNK 16
+
+///////////////////////////////////////////////////////////////////////
+// State shared by every worker of AdjacencyGraph::initialize. The 
+// graph's vertices, bitmap and sweep are only read, and each worker 
+// writes only the rows it has claimed. The next vertex to claim, the 
+// tallies and the output streams are guarded by lock.
+struct EdgeWeightShared
+{
+    const AdjacencyGraph& graph;
+    bitmap* bm;
+    const VisibilitySweep* sweep;
+    EdgeBuilder builder;
+    std::vector<RowOther>& rowOther;
+    std::vector<RowWeight>& rowWeight;
+    std::ostream& out;
+
+    pthread_mutex_t lock;
+    size_t next;
+    size_t completed;
+    size_t candidateCount;
+    size_t disagreements;
+
+    EdgeWeightShared(const AdjacencyGraph& _graph, bitmap* _bm,
+        const VisibilitySweep* _sweep, EdgeBuilder _builder, 
+        std::vector<RowOther>& _rowOther, std::vector<RowWeight>& _rowWeight,
+        std::ostream& _out) :
+        graph(_graph), bm(_bm), sweep(_sweep), builder(_builder), 
+        rowOther(_rowOther), rowWeight(_rowWeight), out(_out), 
+        next(0), completed(0), candidateCount(0), disagreements(0)
+    { pthread_mutex_init(&lock, NULL); }
+
+    ~EdgeWeightShared() { pthread_mutex_destroy(&lock); }
+};
+
+
+///////////////////////////////////////////////////////////////////////
+// Fills the rows handed out by the shared counter until none are left. 
+// Row k holds the edges from vertex k to itself and every later vertex.
+static void* EdgeWeightWorker(void* arg)
+{
+    EdgeWeightShared& sh = *static_cast<EdgeWeightShared*>(arg);
+    const location::Vector& verts = sh.graph.GetVertices();
+    size_t n = verts.size();
+
+    location::Vector candidates;
+    std::vector< std::pair<int,undirectedLength> > swept;
+    RowOther sweptOther;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&sh.lock);
+        size_t first = sh.next;
+        sh.next += EDGE_WEIGHT_CHUNK;
+        pthread_mutex_unlock(&sh.lock);
+
+        if (first >= n) break;
+        size_t last = std::min(first + EDGE_WEIGHT_CHUNK, n);
+
+        size_t candidateCount = 0;
+
+        for (size_t k = first; k < last; k++) {
+            location v = verts[k];
+            RowOther& o = sh.rowOther[k];
+            RowWeight& w = sh.rowWeight[k];
+
+            if (sh.builder != SWEEP_EDGES)
+            for (size_t u = k; u < n; u++) {
+                undirectedLength weight = GetWeight(v, verts[u], sh.bm);
+                if (weight != INT_MAX) {
+                    o.push_back(u);
+                    w.push_back(weight);
+                }
+            }
+
+            if (sh.sweep) {
+                candidates.clear();
+                swept.clear();
+                sh.sweep->Candidates(v, candidates);
+                candidateCount += candidates.size();
+
+                for (location::VectorIter c = candidates.begin(); 
+                        c != candidates.end(); c++) {
+                    undirectedLength weight = GetWeight(v, *c, sh.bm);
+                    if (weight != INT_MAX) swept.push_back
+                        (std::make_pair(sh.graph.VerToInt(*c), weight));
+                }
+
+                std::sort(swept.begin(), swept.end());
+
+                if (sh.builder == SWEEP_EDGES) {
+                    for (size_t i = 0; i < swept.size(); i++) {
+                        if (i > 0 && swept[i].first == swept[i-1].first) 
+                            continue;
+                        o.push_back(swept[i].first);
+                        w.push_back(swept[i].second);
+                    }
+                }
+                else {
+                    sweptOther.clear();
+                    for (size_t i = 0; i < swept.size(); i++)
+                        sweptOther.push_back(swept[i].first);
+                    sweptOther.erase(std::unique
+                        (sweptOther.begin(), sweptOther.end()), 
+                        sweptOther.end());
+
+                    pthread_mutex_lock(&sh.lock);
+                    sh.disagreements += 
+                        ReportDisagreements(v, o, sweptOther, verts);
+                    pthread_mutex_unlock(&sh.lock);
+                }
+            }
+        }
+
+        pthread_mutex_lock(&sh.lock);
+        sh.completed += last - first;
+        sh.candidateCount += candidateCount;
+        sh.out << sh.completed << " / " << n
+            << " vertices' edge weights found...                \r";
+        sh.out.flush();
+        pthread_mutex_unlock(&sh.lock);
+    }
+
+    return 0;
+}
+
+
+/** Builds the graph of all edge weights in G. Each vertex's
+	row of the upper triangle is found by one of #numThreads#
+	threads, by walking the line of sight to every later 
+	vertex or, with SWEEP_EDGES, only to those a rotational
+	sweep leaves. The rows are then mirrored into the edge 
+	arrays, and the perimeter edges of every region are 
+	connected.
+	@param Graph A set of locations as vertices.
+	@param bitmap A bitmap with edge weight function.
+	@param EdgeBuilder How visible vertices are found.
+	@param int Number of threads to find edge weights with.
+	@memo 
+*/
+void AdjacencyGraph::initialize
+(location::Set& G, region::List &vList, bitmap* bm, std::ostream& out,
+EdgeBuilder builder, int numThreads) 
+{
+	bmp = bm;
+	verts.assign(G.begin(), G.end());
+	size_t n = verts.size();
+
+	std::vector<RowOther> rowOther(n);
+	std::vector<RowWeight> rowWeight(n);
+
+    VisibilitySweep* sweep = 0;
+    if (builder != BRESENHAM_EDGES) sweep = new VisibilitySweep(bm, G);
+
+    if (numThreads < 1) numThreads = 1;
+	
+    EdgeWeightShared shared
+        (*this, bm, sweep, builder, rowOther, rowWeight, out);
+    std::vector<pthread_t> threads(numThreads);
+        
+    // Thread 0 is the calling thread.
+    int started = 1;
+    for (; started < numThreads; started++) {
+        if (pthread_create(&threads[started], NULL, 
+            EdgeWeightWorker, &shared) != 0) {
+            std::cerr << "Could not start worker thread " 
+                << started << ".\n";
+            break;
+        }
+    }
+    EdgeWeightWorker(&shared);
+    for (int t = 1; t < started; t++) pthread_join(threads[t], NULL);
+		
+	out << "\n";
+
+    if (sweep) {
+        out << sweep->RunCount() << " impassible runs swept; " 
+            << shared.candidateCount << " of " << n*(n+1)/2 
+            << " vertex pairs needed a line of sight test.\n";
+        delete sweep;
+    }
+
+    if (builder == VALIDATE_EDGES) {
+        if (shared.disagreements == 0) 
+            out << "Visibility sweep agrees with Bresenham on every edge.\n";
+        else
+            std::cerr << "Visibility sweep disagrees with Bresenham on " 
+                << shared.disagreements << " edges.\n";
+    }
+
+	Build(rowOther, rowWeight);
+
+	// Connect edges around impassible regions to ensure polygon construction
+	// doesn't take advantage of diagonal side-stepping 'holes'.
+	// Also, set the region that each vertex belongs to.
+	int j = 0;
+	for (region::List::iterator i = vList.begin(); i != vList.end(); i++) {
+		ConnectEdges(i->toVector());
+		SetRegion(*i, j);
+		j ++;
+	}
+}
+
+
+void AdjacencyGraph::Build
+(std::vector<RowOther>& rowOther, std::vector<RowWeight>& rowWeight)
+{
+	int n = size();
+
+	// Each edge of row k but the self edge is also an edge of its far 
+	// vertex's row.
+	start.assign(n+1, 0);
+	for (int k = 0; k < n; k++) {
+		start[k+1] += rowOther[k].size();
+		for (size_t e = 0; e < rowOther[k].size(); e++)
+			if (rowOther[k][e] != k) start[rowOther[k][e]+1] ++;
+	}
+	for (int k = 0; k < n; k++) start[k+1] += start[k];
+
+	size_t m = start[n];
+	other.resize(m);
+	weight.resize(m);
+	flags.assign(m, USABLE);
+	used.assign(m, 0);
+
+	// Rows are filled in order, so a vertex receives its edges from 
+	// earlier vertices, in their order, before its own.
+	std::vector<int> fill(start.begin(), start.end()-1);
+	for (int k = 0; k < n; k++) {
+		for (size_t e = 0; e < rowOther[k].size(); e++) {
+			int u = rowOther[k][e];
+			other[fill[k]] = u;
+			weight[fill[k]] = rowWeight[k][e];
+			fill[k] ++;
+
+			if (u != k) {
+				other[fill[u]] = k;
+				weight[fill[u]] = rowWeight[k][e];
+				fill[u] ++;
+			}
+			
+			// to do: should i just use the standard convention that in an
+			// undirected graph, self-connectivity is false?
+			else {
+				flags[fill[k]-1] |= CONNECTED;
+				used[fill[k]-1] = MAX_TIMES_USED;
+			}
+		}
+
+		RowOther().swap(rowOther[k]);
+		RowWeight().swap(rowWeight[k]);
+	}
+
+	regionOf.assign(n, -1);
+	posOf.assign(n, -1);
+	convex.resize(n);
+	for (int k = 0; k < n; k++)
+		convex[k] = !region::IsConcaveLocation(*bmp, verts[k]);
+}
+
+
+void AdjacencyGraph::initializeConvex(const AdjacencyGraph& orig)
+{
+	bmp = orig.bmp;
+	int n = orig.size();
+
+	// New id of each of orig's vertices, or -1 if it is dropped.
+	std::vector<int> id(n, -1);
+	verts.clear();
+	for (int k = 0; k < n; k++) {
+		if (!orig.convex[k]) continue;
+		id[k] = verts.size();
+		verts.push_back(orig.verts[k]);
+	}
+
+	start.assign(1, 0);
+	other.clear();
+	weight.clear();
+	flags.clear();
+	used.clear();
+	regionOf.clear();
+	posOf.clear();
+
+	for (int k = 0; k < n; k++) {
+		if (id[k] < 0) continue;
+
+		for (int e = orig.start[k]; e < orig.start[k+1]; e++) {
+			if (id[orig.other[e]] < 0) continue;
+			other.push_back(id[orig.other[e]]);
+			weight.push_back(orig.weight[e]);
+			flags.push_back(orig.flags[e]);
+			used.push_back(orig.used[e]);
+		}
+
+		start.push_back(other.size());
+		regionOf.push_back(orig.regionOf[k]);
+		posOf.push_back(orig.posOf[k]);
+	}
+
+	convex.assign(verts.size(), true);
+}
+
+
+int AdjacencyGraph::Components(std::vector<int>& component) const
+{
+	int n = size();
+	component.assign(n, -1);
+
+	int count = 0;
+	std::vector<int> stack;
+	for (int k = 0; k < n; k++) {
+		if (component[k] >= 0) continue;
+
+		// Every vertex reached from k, the least of them, joins its 
+		// component.
+		component[k] = k;
+		stack.push_back(k);
+		while (!stack.empty()) {
+			int v = stack.back();
+			stack.pop_back();
+			for (int e = start[v]; e < start[v+1]; e++) {
+				if (component[other[e]] >= 0) continue;
+				component[other[e]] = k;
+				stack.push_back(other[e]);
+			}
+		}
+		count++;
+	}
+
+	return count;
+}
+
+
+//===================================================================
+// ConnectEdges(): Connects edges of the perimeter of polygon P, as 
+//		AdjacencyMatrix::ConnectEdges does.
+//
+bool AdjacencyGraph::ConnectEdges
+(const location::Vector& Vp) 
+{
+	if (Vp.size() == 0) return false;
+
+	location::ConstVectorIter v1 = Vp.begin(); 			// Let v1 := V_1
+	location::ConstVectorIter v2 = Vp.begin(); v2 ++;	// Let v2 := V_2
+	location::ConstVectorIter vn = Vp.end();			// Let vn := V_n
+
+    EdgeIter f = GetEdgeIterator(*v1, Vp.back());
+    if (f.IsEdge() && f.Usable()) {
+        f.SetConnectedBidirectional(true); // Connect vi and vi+1
+        f.IncTimesUsed();
+        f.Transpose().IncTimesUsed();
+        if (f.TimesUsed() > MAX_TIMES_USED && *v1 != Vp.back()) {
+            f.SetUsableBidirectional(false);
+        }
+    }
+    
+    else return false;
+    
+	// in the special case where v2 == vn already, Vp is a single edge (2 verts)
+	while (v2 != vn) {
+		EdgeIter f = GetEdgeIterator(*v1, *v2);
+        if (f.IsEdge() && f.Usable()) {
+            f.SetConnectedBidirectional(true); // Connect vi and vi+1
+            f.IncTimesUsed();
+            f.Transpose().IncTimesUsed();
+            if (f.TimesUsed() > MAX_TIMES_USED) {
+                f.SetUsableBidirectional(false);
+            }
+        }
+        
+        else return false;
+
+		v2++; v1++;
+	}
+	
+	return true;
+}
+
+
+void AdjacencyGraph::SetRegion (region& Vp, int j) 
+{
+	location::ConstVectorIter v = Vp.toVector().begin(); 	// Let v1 := V_1
+	location::ConstVectorIter vn = Vp.toVector().end();		// Let vn := V_n
+		
+	int k = 0;
+	while (v != vn) {
+		int a = VerToInt(*v);
+		if (a >= 0) {
+			regionOf[a] = j;
+			posOf[a] = k;
+		}
+		
+		k++;
+		v++;
+	}
+}
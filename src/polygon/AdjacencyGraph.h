@@ -0,0 +1,335 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADJACENCYGRAPH_H
+#define ADJACENCYGRAPH_H
+
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include "../bitmap/bitmap.h"
+#include "../location/location.hpp"
+#include "../region/region.h"
+#include "../thorup/Graph.h"
+
+// Times an edge may be used as a polygon edge before it is unusable. 
+// Self edges start at this count.
+#define MAX_TIMES_USED 4
+
+// How visible vertex pairs are found.
+//   BRESENHAM_EDGES walks the digital line between every pair of vertices.
+//   SWEEP_EDGES     walks it only for the pairs left by a VisibilitySweep.
+//   VALIDATE_EDGES  does both, reports any pair they disagree on and keeps
+//                   the Bresenham result.
+enum EdgeBuilder { BRESENHAM_EDGES, SWEEP_EDGES, VALIDATE_EDGES };
+
+////////////////////////////////////////////////////////////////////////////////
+/** Undirected visibility graph in compressed sparse row form. 
+
+	Vertex ids are the positions of the vertices' locations in sorted 
+	order, assigned once. The edges of vertex v are entries start[v] up to 
+	start[v+1] of the edge arrays, sorted by the id of their far vertex, 
+	and each edge is stored once from either end. Every vertex has an edge 
+	to itself. An edge costs its far vertex's id, its weight, and a byte
+	each of flags and use count, against a tree node per end in an 
+	AdjacencyMatrix.
+
+	The graph's shape is fixed once built; only the edges' flags and use
+	counts and the vertices' regions change. EdgeIter walks it with the 
+	same calls as AdjacencyMatrix::EdgeIter. 
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class AdjacencyGraph {
+
+	public:
+
+		// Bits of an edge's flags.
+		enum { USABLE = 1, CONNECTED = 2 };
+
+	private:
+
+		bitmap* bmp;
+
+		location::Vector verts;             // Location of each vertex id
+		std::vector<int> start;             // First edge of each vertex id
+		std::vector<int> other;             // Far vertex of each edge
+		std::vector<undirectedLength> weight;
+		std::vector<unsigned char> flags;   // USABLE | CONNECTED
+		std::vector<unsigned char> used;    // Times used as a polygon edge
+
+		std::vector<int> regionOf;          // Region of each vertex id
+		std::vector<int> posOf;             // Position in its region
+		std::vector<bool> convex;           // Whether it isn't concave
+
+		// Marks the perimeter edges of polygon #Vp# connected, as 
+		// AdjacencyMatrix::ConnectEdges does.
+		bool ConnectEdges(const location::Vector& Vp);
+
+		// Records region #j# and each vertex's position in it.
+		void SetRegion(region& Vp, int j);
+
+		// Fills the edge arrays from the rows of the upper triangle, row k
+		// holding the ids and weights of the edges from vertex k to itself
+		// and later vertices in order, releasing each row as it goes. Then
+		// finds the vertices' convexity.
+		void Build(std::vector< std::vector<int> >& rowOther, 
+			std::vector< std::vector<undirectedLength> >& rowWeight);
+
+	public:
+
+		/////////////////////////////////////////////////////
+		/** @name Constructors **/
+		//@{
+
+		// Allocates an empty graph.
+		AdjacencyGraph() : bmp(0), start(1, 0) { }
+
+		//@}
+
+
+		/////////////////////////////////////////////////////
+		/** @name Public Types **/
+		//@{
+
+		class EdgeIter {
+
+			private:
+
+			bool initialized;
+			AdjacencyGraph* g;
+
+			int col;                        // Vertex id
+			int row;                        // Edge index
+
+			public:
+
+			EdgeIter(AdjacencyGraph* _g) : 
+				initialized(true), g(_g), col(0), row(g->start[0]) { }
+
+			EdgeIter(location _col, AdjacencyGraph* _g) : g(_g), row(0) {
+				col = g->VerToInt(_col);
+				initialized = col >= 0;
+				if (initialized) ResetRow();
+			}
+
+			EdgeIter(location _col, location _row, AdjacencyGraph* _g) : 
+				g(_g), row(-1) {
+				col = g->VerToInt(_col);
+				if (col >= 0) row = g->FindEdge(col, g->VerToInt(_row));
+				initialized = row >= 0;
+			}
+
+			EdgeIter(int _col, int _edge, AdjacencyGraph* _g) : 
+				initialized(_edge >= 0), g(_g), col(_col), row(_edge) { }
+
+			bool IsEdge() const { return initialized; }
+
+			void SetUsable(bool _usable) {
+				if (_usable) g->flags[row] |= USABLE;
+				else g->flags[row] &= ~USABLE;
+			}
+
+			void SetConnected(bool _connected) {
+				if (_connected) g->flags[row] |= CONNECTED;
+				else g->flags[row] &= ~CONNECTED;
+			}
+
+			void SetUsableBidirectional(bool _usable) { 
+				SetUsable(_usable);
+				Transpose().SetUsable(_usable);
+			}
+
+			void SetConnectedBidirectional(bool _connected) { 
+				SetConnected(_connected);
+				Transpose().SetConnected(_connected);
+			}
+
+			bool Usable() const { return g->flags[row] & USABLE; }
+			bool Connected() const { return g->flags[row] & CONNECTED; }
+			int TimesUsed() const { return g->used[row]; }
+			void IncTimesUsed() { g->used[row]++; }
+			void SetTimesUsed(int _used) { g->used[row] = _used; }
+			undirectedLength Weight() const { return g->weight[row]; }
+			int& Region() const { return g->regionOf[col]; }
+			int& Position() const { return g->posOf[col]; }
+
+			/** Id of the column's vertex. */
+			int Col() const { return col; }
+
+			/** Id of the row's vertex. */
+			int Row() const { return g->other[row]; }
+
+			/** Index of the edge in the graph's edge arrays. */
+			int Edge() const { return row; }
+
+			void ResetCol() { col = 0; ResetRow(); }
+			void ResetRow() { row = g->start[col]; }
+
+			bool HasNextCol() const 
+				{ return (initialized) ? col < g->size() : false; }
+			bool HasNextRow() const 
+				{ return (initialized) ? row < g->start[col+1] : false; }
+
+			void NextCol() { col++; ResetRow(); }
+			void NextRow() { row++; }
+
+			bool SetCol(location loc) {
+				if (initialized) {
+					int c = g->VerToInt(loc);
+					if (c < 0) return false;
+					col = c;
+					ResetRow();
+					return true;
+				}
+				return false;
+			}
+
+			bool SetRow(location loc) {
+				if (initialized) {
+					int r = g->FindEdge(col, g->VerToInt(loc));
+					if (r < 0) return false;
+					row = r;
+					return true;
+				}
+				return false;
+			}
+
+			size_t size() const 
+				{ return (initialized) ? g->start[col+1] - g->start[col] : 0; }
+
+			size_t UsableEdgeCount() const {
+				size_t count = 0;
+				for (int r = g->start[col]; r < g->start[col+1]; r++)
+					count += g->flags[r] & USABLE;
+				return count;
+			}
+
+			size_t ConnectedEdgeCount() const {
+				size_t count = 0;
+				for (int r = g->start[col]; r < g->start[col+1]; r++)
+					count += (g->flags[r] & CONNECTED) ? 1 : 0;
+				return count;
+			}
+
+			location ColLoc() const { return g->verts[col]; }
+			location RowLoc() const { return g->verts[g->other[row]]; }
+
+			EdgeIter Transpose() const { 
+				int r = g->other[row];
+				return EdgeIter(r, g->FindEdge(r, col), g);
+			}
+
+			bool ColIsConvex() const { return g->convex[col]; }
+			bool RowIsConvex() const { return g->convex[g->other[row]]; }
+		};
+
+		//@}
+
+
+		/////////////////////////////////////////////////////
+		/** @name Public Members **/
+		//@{
+
+		EdgeIter GetEdgeIterator() { return EdgeIter(this); }
+		EdgeIter GetEdgeIterator(location _col) 
+			{ return EdgeIter(_col,this); }
+		EdgeIter GetEdgeIterator(location _col, location _row) 
+			{ return EdgeIter(_col,_row,this); }
+
+		/** Finds the edges among the vertices in #G# with a line of sight
+			between them, on #numThreads# threads, then connects the 
+			perimeter edges of each region in #vList#. */
+		void initialize
+			(location::Set& G, region::List &vList, bitmap* bm, 
+			std::ostream& out, EdgeBuilder builder = BRESENHAM_EDGES, 
+			int numThreads = 1);
+
+		/** Discards this graph's contents and makes it the part of #orig# 
+			among vertices that aren't concave, vertex ids in the same 
+			order. */
+		void initializeConvex(const AdjacencyGraph& orig);
+
+		/** Fills #component# with the connected component of each 
+			vertex id, named by the least id in it, and returns the number 
+			of components. No path joins two of them. */
+		int Components(std::vector<int>& component) const;
+
+		/** Number of vertices. */
+		int size() const { return (int)verts.size(); }
+
+		/** Number of edges, counting self edges once and others twice. */
+		size_t TotalEdgeCount() const { return other.size(); }
+
+		/** The id of the vertex at #loc#, or -1 if there is none. */
+		int VerToInt(location loc) const {
+			location::ConstVectorIter i = 
+				std::lower_bound(verts.begin(), verts.end(), loc);
+			if (i == verts.end() || *i != loc) return -1;
+			return (int)(i - verts.begin());
+		}
+
+		location IntToVer(int v) const { return verts[v]; }
+
+		/** The index of the edge from vertex #v# to vertex #u#, or -1 if 
+			there is none. */
+		int FindEdge(int v, int u) const {
+			if (v < 0 || u < 0) return -1;
+			std::vector<int>::const_iterator first = other.begin()+start[v];
+			std::vector<int>::const_iterator last = other.begin()+start[v+1];
+			std::vector<int>::const_iterator i = 
+				std::lower_bound(first, last, u);
+			if (i == last || *i != u) return -1;
+			return (int)(i - other.begin());
+		}
+
+		/** First edge of vertex #v#; its last is before First(v+1). */
+		int First(int v) const { return start[v]; }
+		int Other(int edge) const { return other[edge]; }
+
+		bitmap* GetBitmap() const { return bmp; }
+
+		const location::Vector& GetVertices() const { return verts; }
+
+		location::Vector GetConvexVertices() const {
+			location::Vector v;
+			for (int i = 0; i < size(); i++)
+				if (convex[i]) v.push_back(verts[i]);
+			return v;
+		}
+
+		//@}
+};
+
+#endif
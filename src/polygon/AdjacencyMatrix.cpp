@@ -36,8 +36,6 @@
 #include <utility>
 #include "../thorup/Graph.h"
 
-#define MAX_TIMES_USED 4
-
 #define DBG_LOC_ONE 114,387
 #define DBG_LOC_TWO 268,262
 
@@ -57,9 +55,10 @@ const location loc_two(DBG_LOC_TWO);
 	@memo 
 */
 AdjacencyMatrix::AdjacencyMatrix
-(location::Set& G, region::List &vList, bitmap* bm, std::ostream& out) 
+(location::Set& G, region::List &vList, bitmap* bm, std::ostream& out,
+EdgeBuilder builder, int numThreads) 
 {
-	initialize(G,vList,bm,out);
+	initialize(G,vList,bm,out,builder,numThreads);
 }
 
 
@@ -90,15 +89,27 @@ AdjacencyMatrix::AdjacencyMatrix
 }
 
 
+/** Copies the edges of #orig# between vertices that aren't concave. Each
+	column's convexity is kept with its vertex in #orig# and each row's is
+	a lookup of its cell's neighbourhood code.
+	@memo
+*/
 AdjacencyMatrix::AdjacencyMatrix
-(AdjacencyMatrix& orig) 
+(AdjacencyMatrix& orig) : 
+	ConnectedUnusable(0), beginThorough(false), finished(false), 
+	MIN_USABLE(MIN_USABLE_INIT), bmp(orig.bmp)
 {	
+    iterator hint = begin();
     EdgeIter e = orig.GetEdgeIterator();
     for (e.ResetCol(); e.HasNextCol(); e.NextCol())
-    if (e.ColIsConvex())
+    if (e.ColIsConvex()) {
+        hint = insert(hint, AdjacencyPair(e.ColLoc(), PolyEdgeMap()));
+        PolyEdgeMap& m = hint->second;
+        m.convex = true;
         for (e.ResetRow(); e.HasNextRow(); e.NextRow())
         if (e.RowIsConvex())
-            (*this)[e.ColLoc()].insert(*e.Row());
+            m.insert(m.end(), *e.Row());
+    }
 }
 
 
@@ -162,79 +173,52 @@ void AdjacencyMatrix::initializeSubmatrix
     }
 }
 
+
 /** Builds a matrix containing all edge weights in G. Run 
 	time is inherently $O(\sum |E_i| + V^2/2)$ -- the sum 
 	of undirected edge weights in G plus the time to parse 
-	each vertex to vertex combination. In short, for a 
-	dense graph, this is a lengthy process.
+	each vertex to vertex combination. The edges are found
+	as an AdjacencyGraph (see AdjacencyGraph::initialize)
+	and then copied into the matrix.
 	@param Graph A set of locations as vertices.
 	@param bitmap A bitmap with edge weight function.
+	@param EdgeBuilder How visible vertices are found.
+	@param int Number of threads to find edge weights with.
 	@memo 
 */
 void AdjacencyMatrix::initialize
-(location::Set& G, region::List &vList, bitmap* bm, std::ostream& out) 
+(location::Set& G, region::List &vList, bitmap* bm, std::ostream& out,
+EdgeBuilder builder, int numThreads) 
 {
+	AdjacencyGraph graph;
+	graph.initialize(G, vList, bm, out, builder, numThreads);
+	initialize(graph);
+}
+
+
+void AdjacencyMatrix::initialize(AdjacencyGraph& graph)
+{
+	clear();
+	clipIndex.clear();
     MIN_USABLE = MIN_USABLE_INIT;
-	bmp = bm;
+	bmp = graph.GetBitmap();
 	ConnectedUnusable = 0;
 	beginThorough = false;
 	finished = false;
 
-	// Continue initialization of the matrix
-	location::SetIter v = G.begin();
-	location::SetIter done = G.end();
-
-    size_t G_size = G.size();
-    size_t completed = 0;
+    iterator hint = begin();
+    AdjacencyGraph::EdgeIter e = graph.GetEdgeIterator();
+    for (e.ResetCol(); e.HasNextCol(); e.NextCol()) {
+        hint = insert(hint, AdjacencyPair(e.ColLoc(), 
+            PolyEdgeMap(e.Region(), e.Position())));
+        PolyEdgeMap& m = hint->second;
 	
-	while (v != done) {
-        
-		/* Take advantage of Graph elements begin sorted and unique
-		 * when G is an undirected graph.
-		 * If a directed graph is needed, simply change 'v' to 'G.begin()'
-		 * in the next line and comment out the specified line below */
-		location::SetIter u = v;
-		PolyEdgeMap m;
-		
-		while (u != done) {
-			
-			undirectedLength weight = GetWeight(*v, *u, bm);
-			if (weight != INT_MAX) {
-				PolyEdge p(true, false, weight);
-				m[*u] = p;
-			}
-			u++;
-		}
-		
-		(*this)[*v] = m;
-//        Display(GetEdgeIterator(*v,*v),std::cerr);
-		v++;
-		completed ++;
-        
-        if (! (completed % 10)) {
-            out << completed << " / " << G_size 
-                << " vertices' edge weights found...                \r";
-            out.flush();
+        for (e.ResetRow(); e.HasNextRow(); e.NextRow()) {
+            PolyEdge p(e.Usable(), e.Connected(), e.Weight());
+            p.used = e.TimesUsed();
+            m.insert(m.end(), PolyEdgePair(e.RowLoc(), p));
         }
-	}
-	
-    out << completed << " / " << G_size 
-        << " vertices' edge weights found...                \r";
-    out.flush();
-	out << "\n";
-
-	/* For a directed graph, comment this line and see instructions above. */
-	AddTranspose();
-
-	// Connect edges around impassible regions to ensure polygon construction
-	// doesn't take advantage of diagonal side-stepping 'holes'.
-	// Also, set the region that each vertex belongs to.
-	int j = 0;
-	for (region::List::iterator i = vList.begin(); i != vList.end(); i++) {
-		ConnectEdges(i->toVector());
-		SetRegion(*i, j);
-		j ++;
-	}
+    }
 }
 
 
@@ -398,49 +382,84 @@ void AdjacencyMatrix::AddTranspose()
 
 
 //===================================================================
-// RemoveExternalClipping(): Examines all edges in the graph represented by
-// 		this matrix, removing all edges intersecting 'edges' from 
-//		usability.
+// RemoveExternalClipping(): Examines the edges in the graph represented 
+// 		by this matrix that may meet the perimeter of Vp, removing all 
+//		edges intersecting 'edges' from usability. Those edges are found
+//		in clipIndex; when Vp has a repeated or a lone point, whose 
+//		intersection tests treat it as a segment, every edge is examined.
 // Input:  location vector whose adjacent vertex combinations are
 //		perimiter edges in a polygon.
 //
 void AdjacencyMatrix::RemoveExternalClipping 
 (const location::Vector& Vp) 
 {	
-	EdgeIter thisEdge = GetEdgeIterator();
+	bool degenerate = Vp.size() < 2 || Vp.front() == Vp.back();
+	for (size_t k = 0; k+1 < Vp.size(); k++) 
+		if (Vp[k] == Vp[k+1]) degenerate = true;
 	
-	while ( thisEdge.HasNextCol() ) {
+	if (degenerate) {
+		EdgeIter thisEdge = GetEdgeIterator();
 		
-		thisEdge.FindRow(thisEdge.ColLoc());
-		thisEdge.NextRow();
+		while ( thisEdge.HasNextCol() ) {
 		
-		while ( thisEdge.HasNextRow() ) {
+			thisEdge.FindRow(thisEdge.ColLoc());
+			thisEdge.NextRow();
 			
+			while ( thisEdge.HasNextRow() ) {
+				if (thisEdge.Usable() && !thisEdge.Connected()) {
+					thisEdge.SetUsableBidirectional( 
+						DoesntClip(Vp, thisEdge.ColLoc(), thisEdge.RowLoc()));
+				}
+				thisEdge.NextRow();
+			} 
 			
-			// Unusable implies unconnected <=> Usable or connected 
-			// <=> If unusable then unconnected.
-			//assert(L1P2->second.usable || L1P2->second.connected == false);
-
-			// Check edge for instersections with perimeter of polygon.
-			// Since all polygon edges are now connected,
-			// we are only looking for non-Vp edges to test against Vp edges.
-			// We use DoesntClip because edges with a vertex shared by
-			// the polygon Vp should remain usable.
-
-//			location head = Vp.front();
-			if (thisEdge.Usable() && !thisEdge.Connected()) {
-				thisEdge.SetUsableBidirectional( 
-					DoesntClip(Vp, thisEdge.ColLoc(), thisEdge.RowLoc()));
-				//thisEdge.Transpose().SetUsable(thisEdge.Usable());
-			}
-			 
-			//L1P2++; 
-			thisEdge.NextRow();
-		} 
+			thisEdge.NextCol(); 
+		}
 		
-		thisEdge.NextCol(); 
+		return;
 	}
-	
+
+	if (!clipIndex.IsBuilt()) BuildClipIndex();
+
+	std::vector<int> candidates;
+	clipIndex.Find(Vp, candidates);
+
+	for (size_t k = 0; k < candidates.size(); k++) {
+		const location::Line& line = clipIndex.Segment(candidates[k]);
+		EdgeIter thisEdge = GetEdgeIterator(line.first, line.second);
+
+		// Unusable edges between distinct vertices stay that way.
+		if (!thisEdge.IsEdge() || !thisEdge.Usable()) {
+			clipIndex.Remove(candidates[k]);
+			continue;
+		}
+
+		// Check edge for instersections with perimeter of polygon.
+		// Since all polygon edges are now connected,
+		// we are only looking for non-Vp edges to test against Vp edges.
+		// We use DoesntClip because edges with a vertex shared by
+		// the polygon Vp should remain usable.
+		if (thisEdge.Connected()) continue;
+
+		if (!DoesntClip(Vp, line.first, line.second)) {
+			thisEdge.SetUsableBidirectional(false);
+			clipIndex.Remove(candidates[k]);
+		}
+	}
+}
+			
+			
+void AdjacencyMatrix::BuildClipIndex() 
+{
+	location::LineVector edges;
+	EdgeIter i = GetEdgeIterator();
+
+	for (i.ResetCol(); i.HasNextCol(); i.NextCol())
+	for (i.ResetRow(); i.HasNextRow(); i.NextRow())
+		if (i.ColLoc() < i.RowLoc() && i.Usable())
+			edges.push_back(location::Line(i.ColLoc(), i.RowLoc()));
+
+	clipIndex.Build(edges);
 }
 
 
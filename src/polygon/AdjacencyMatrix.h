@@ -41,6 +41,8 @@
 #include "../location/location.hpp"
 #include "math_vector.hpp"
 #include "../region/region.h"
+#include "AdjacencyGraph.h"
+#include "SegmentGrid.h"
 
 #define MIN_USABLE_INIT 1
 
@@ -60,12 +62,13 @@ typedef std::pair<location,PolyEdge> PolyEdgePair;
 class  PolyEdgeMap : public std::map <location,PolyEdge> {
 	public: bool wasHead; int region; int pos; int usable; int connected;
         int unused;
+        int convex;     // Whether this vertex isn't concave (-1 for unknown)
 	PolyEdgeMap() : 
         wasHead(false), region(-1), pos(-1), usable(-1), connected(-1), 
-        unused(-1) { }
+        unused(-1), convex(-1) { }
 	PolyEdgeMap(int _region, int _pos) : 
 		wasHead(false), region(_region), pos(_pos), usable(-1), connected(-1), 
-		unused(-1) { }
+		unused(-1), convex(-1) { }
 };
 typedef std::pair<location,PolyEdgeMap> AdjacencyPair;
 
@@ -86,6 +89,11 @@ class AdjacencyMatrix : public std::map<location,PolyEdgeMap> {
     size_t MIN_USABLE;
 	bitmap* bmp;
 	
+	// Usable edges between distinct vertices, each once, for finding 
+	// those a polygon may clip. Built by the first RemoveExternalClipping 
+	// that needs it; edges are dropped from it once unusable.
+	SegmentGrid clipIndex;
+	
 	protected:
 	
 	struct Edge {
@@ -104,7 +112,7 @@ class AdjacencyMatrix : public std::map<location,PolyEdgeMap> {
 	// AddTranspose(): Applies the transform A := A + A^T where 
 	// 		A is upper triangular.
 	void AddTranspose();
-	
+
 	// DoesntClip(): Predicate to test clipping of an edge a1-a2 on a 
 	//		polygon P.
 	// Returns: True if a1-a2 doesn't intersect any edges in the perimeter 
@@ -119,6 +127,10 @@ class AdjacencyMatrix : public std::map<location,PolyEdgeMap> {
 	//		perimiter edges in a polygon.
 	void RemoveExternalClipping (const location::Vector& Vp);
 
+	// BuildClipIndex(): Lists every usable edge between distinct vertices
+	//		in clipIndex.
+	void BuildClipIndex();
+
 	// RemoveDiagonals(): Removes edges in polygon P that are not part of
 	//		of the perimeter of P.
 	void RemoveDiagonals(const location::Vector& Vp);
@@ -212,7 +224,8 @@ class AdjacencyMatrix : public std::map<location,PolyEdgeMap> {
 	
 	// Builds a matrix containing all edge weights in G.
 	AdjacencyMatrix
-        (location::Set& G, region::List &vList, bitmap* bm, std::ostream& out);
+        (location::Set& G, region::List &vList, bitmap* bm, std::ostream& out,
+        EdgeBuilder builder = BRESENHAM_EDGES, int numThreads = 1);
 	
     AdjacencyMatrix(AdjacencyMatrix& orig);
 
@@ -459,8 +472,13 @@ class AdjacencyMatrix : public std::map<location,PolyEdgeMap> {
 			return EdgeIter(row->first, col->first, mat);
 		}
 		
-		bool ColIsConvex() 
-            {return !region::IsConcaveLocation(*mat->bmp, ColLoc());}
+		// Whether the column's vertex isn't concave; found once and kept
+		// with the vertex.
+		bool ColIsConvex() {
+            if (col->second.convex == -1) col->second.convex = 
+                !region::IsConcaveLocation(*mat->bmp, ColLoc());
+            return col->second.convex;
+        }
 		bool RowIsConvex() 
             {return !region::IsConcaveLocation(*mat->bmp, RowLoc());}
 	};
@@ -490,7 +508,12 @@ class AdjacencyMatrix : public std::map<location,PolyEdgeMap> {
 		{ return EdgeIter(_col,_row,this); }	
 
 	void initialize
-        (location::Set& G, region::List &vList, bitmap* bm, std::ostream& out);
+        (location::Set& G, region::List &vList, bitmap* bm, std::ostream& out,
+        EdgeBuilder builder = BRESENHAM_EDGES, int numThreads = 1);
+	
+	// Fills this matrix with the edges of #graph#, their flags and use
+	// counts, and its vertices' regions.
+	void initialize(AdjacencyGraph& graph);
 	
     std::ostream& Display(std::ostream& out);
     std::ostream& Display(EdgeIter i, std::ostream& out);
@@ -552,7 +575,7 @@ class AdjacencyMatrix : public std::map<location,PolyEdgeMap> {
 	    location::Vector v;
 	    EdgeIter i = GetEdgeIterator();
 	    for (i.ResetCol(); i.HasNextCol(); i.NextCol())
-            if (!region::IsConcaveLocation(*bmp, i.ColLoc()))
+            if (i.ColIsConvex())
                 v.push_back(i.ColLoc());
         return v;
 	}
@@ -560,7 +583,7 @@ class AdjacencyMatrix : public std::map<location,PolyEdgeMap> {
 	void RemoveConcaveVertices() {
 	    EdgeIter i = GetEdgeIterator();
 	    for (i.ResetCol(); i.HasNextCol(); i.NextCol())
-            if (region::IsConcaveLocation(*bmp, i.ColLoc())) {
+            if (!i.ColIsConvex()) {
                 EraseVertex(i.ColLoc());
                 i.ResetCol();
             }
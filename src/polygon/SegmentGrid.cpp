@@ -0,0 +1,160 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SegmentGrid.h"
+#include <algorithm>
+#include <math.h>
+
+// Lists a segment in each cell it is walked through.
+struct SegmentGrid::Insert {
+	std::vector< std::vector<int> >& cells;
+	int id;
+
+	void operator() (int cell) { cells[cell].push_back(id); }
+};
+
+
+// Gathers the live segments of each cell walked through, once each, and
+// drops removed segments from the cells on the way.
+struct SegmentGrid::Collect {
+	SegmentGrid& grid;
+	std::vector<int>& out;
+
+	void operator() (int cell) {
+		std::vector<int>& ids = grid.cells[cell];
+		for (size_t i = 0; i < ids.size(); ) {
+			int id = ids[i];
+			if (!grid.live[id]) {
+				ids[i] = ids.back();
+				ids.pop_back();
+				continue;
+			}
+			if (grid.seen[id] != grid.query) {
+				grid.seen[id] = grid.query;
+				out.push_back(id);
+			}
+			i ++;
+		}
+	}
+};
+
+
+template<typename Visitor>
+void SegmentGrid::Walk(location a, location b, Visitor& visit) const {
+	if (a.x > b.x) std::swap(a,b);
+
+	int cx0 = std::max(0,      (a.x - 1 - origin.x) / cellSize);
+	int cx1 = std::min(cols-1, (b.x + 1 - origin.x) / cellSize);
+
+	double slope = (a.x == b.x) ? 0 : (double)(b.y - a.y) / (b.x - a.x);
+
+	for (int cx = cx0; cx <= cx1; cx ++) {
+
+		// The part of a-b over this column of cells, padded by a pixel.
+		double y0 = a.y, y1 = b.y;
+		if (a.x != b.x) {
+			double x0 = std::max((double)a.x, origin.x + cx*cellSize - 1.);
+			double x1 = std::min((double)b.x, origin.x + (cx+1)*cellSize + 0.);
+			y0 = a.y + slope*(x0 - a.x);
+			y1 = a.y + slope*(x1 - a.x);
+		}
+
+		double lo = std::min(y0,y1) - 1 - origin.y;
+		double hi = std::max(y0,y1) + 1 - origin.y;
+		int cy0 = std::max(0,      (int)floor(lo / cellSize));
+		int cy1 = std::min(rows-1, (int)floor(hi / cellSize));
+
+		for (int cy = cy0; cy <= cy1; cy ++) visit(cy*cols + cx);
+	}
+}
+
+
+void SegmentGrid::Build(const location::LineVector& _segments, int _cellSize) 
+{
+	clear();
+	segments = _segments;
+	cellSize = std::max(1, _cellSize);
+	built = true;
+
+	if (segments.empty()) return;
+
+	location lo = segments.front().first;
+	location hi = lo;
+	for (location::LineVector::const_iterator s = segments.begin(); 
+			s != segments.end(); s++) {
+		lo.x = std::min(lo.x, std::min(s->first.x, s->second.x));
+		lo.y = std::min(lo.y, std::min(s->first.y, s->second.y));
+		hi.x = std::max(hi.x, std::max(s->first.x, s->second.x));
+		hi.y = std::max(hi.y, std::max(s->first.y, s->second.y));
+	}
+
+	// A cell of margin on either side takes in the padding.
+	origin = location(lo.x - cellSize, lo.y - cellSize);
+	cols = (hi.x - origin.x) / cellSize + 2;
+	rows = (hi.y - origin.y) / cellSize + 2;
+	cells.resize((size_t)cols * rows);
+
+	live.assign(segments.size(), true);
+	seen.assign(segments.size(), 0);
+
+	for (size_t i = 0; i < segments.size(); i++) {
+		Insert insert = { cells, (int)i };
+		Walk(segments[i].first, segments[i].second, insert);
+	}
+}
+
+
+void SegmentGrid::clear() 
+{
+	segments.clear();
+	live.clear();
+	seen.clear();
+	cells.clear();
+	cols = rows = 0;
+	query = 0;
+	built = false;
+}
+
+
+void SegmentGrid::Find(const location::Vector& V, std::vector<int>& out) 
+{
+	if (V.empty() || segments.empty()) return;
+
+	if (++query == 0) {
+		seen.assign(segments.size(), 0);
+		query = 1;
+	}
+
+	Collect collect = { *this, out };
+	for (size_t i = 0; i+1 < V.size(); i++) Walk(V[i], V[i+1], collect);
+	Walk(V.back(), V.front(), collect);
+}
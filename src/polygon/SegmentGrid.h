@@ -0,0 +1,118 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEGMENTGRID_H
+#define SEGMENTGRID_H
+
+#include <vector>
+#include "../location/location.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+/** Uniform grid of square cells over a set of line segments, for finding
+	the segments that may cross a polyline without testing every one.
+
+	Each segment is listed in every cell it passes through, padded by a 
+	pixel, rather than in every cell of its bounding box, so long segments 
+	cost cells in proportion to their length. Two segments that meet do so 
+	in a cell both are listed in, so #Find# returns every segment meeting 
+	the polyline's segments, along with some that only pass near them.
+
+	Segments are removed by marking them; their ids are dropped from the
+	cells as queries come across them.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class SegmentGrid {
+
+	private:
+		int cellSize;
+		location origin;                    // Least corner of cell (0,0)
+		int cols;
+		int rows;
+		bool built;
+
+		location::LineVector segments;
+		std::vector<bool> live;
+		std::vector< std::vector<int> > cells;  // Segment ids, row major
+
+		std::vector<unsigned> seen;         // Query each id was last found by
+		unsigned query;
+
+		// Calls #visit# with the index of each cell #a#-#b# passes 
+		// through, padded by a pixel.
+		template<typename Visitor>
+		void Walk(location a, location b, Visitor& visit) const;
+
+		struct Insert;
+		struct Collect;
+
+	public:
+
+		/////////////////////////////////////////////////////
+		/** @name Constructors **/
+		//@{
+
+		SegmentGrid() : cellSize(1), cols(0), rows(0), built(false), 
+			query(0) { }
+
+		//@}
+
+
+		/////////////////////////////////////////////////////
+		/** @name Public Members **/
+		//@{
+
+		/** Discards the grid's contents and lists #_segments#, segment i
+			having id i, in cells #_cellSize# pixels wide. */
+		void Build(const location::LineVector& _segments, int _cellSize = 16);
+
+		/** Discards the grid's contents. */
+		void clear();
+
+		/** True once Build has been called since construction or clear. */
+		bool IsBuilt() const { return built; }
+
+		/** Appends to #out# the id of every segment not removed that may 
+			meet the closed polyline through #V#, each once. */
+		void Find(const location::Vector& V, std::vector<int>& out);
+
+		const location::Line& Segment(int id) const { return segments[id]; }
+
+		/** Removes segment #id# from later results. */
+		void Remove(int id) { live[id] = false; }
+
+		//@}
+};
+
+#endif
@@ -0,0 +1,105 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "VisibilityIndex.h"
+#include "VisibilitySweep.h"
+#include <algorithm>
+
+void VisibilityIndex::Build(bitmap* bm, const std::vector<location>& verts, 
+	int _blockSize, std::ostream& out) {
+
+	Clear();
+
+	const PassabilityGrid& grid = bm->Grid();
+	blockSize = std::max(_blockSize, 1);
+	blocksX = (grid.GetWidth()  + blockSize - 1) / blockSize;
+	blocksY = (grid.GetHeight() + blockSize - 1) / blockSize;
+	size_t blocks = (size_t)blocksX*blocksY;
+
+	location::Set G(verts.begin(), verts.end());
+	VisibilitySweep sweep(bm, G, true);
+
+	// Vertices are visited in order, so each block's list comes out 
+	// sorted; lastSeen keeps a vertex from being listed twice in a block.
+	std::vector< std::vector<int> > lists(blocks);
+	std::vector<int> lastSeen(blocks, -1);
+	std::vector<VisibilitySweep::Span> spans;
+
+	for (size_t k = 0; k < verts.size(); k ++) {
+
+		// No pixel has line of sight to a vertex off the image.
+		if (!grid.Contains(verts[k].x, verts[k].y)) continue;
+
+		spans.clear();
+		sweep.VisibleSpans(verts[k], spans);
+
+		for (size_t s = 0; s < spans.size(); s ++) {
+			size_t row = (size_t)(spans[s].y / blockSize)*blocksX;
+			for (int bx = spans[s].x0 / blockSize; 
+				bx <= spans[s].x1 / blockSize; bx ++) {
+				if (lastSeen[row + bx] == (int)k) continue;
+				lastSeen[row + bx] = k;
+				lists[row + bx].push_back(k);
+			}
+		}
+
+		if (k % 64 == 0 || k+1 == verts.size()) {
+			out << k+1 << " / " << verts.size() 
+				<< " vertices' visible blocks found...       \r";
+			out.flush();
+		}
+	}
+	out << "\n";
+
+	start.resize(blocks + 1);
+	start[0] = 0;
+	for (size_t b = 0; b < blocks; b ++) 
+		start[b+1] = start[b] + lists[b].size();
+
+	vertices.reserve(start[blocks]);
+	for (size_t b = 0; b < blocks; b ++) {
+		vertices.insert(vertices.end(), lists[b].begin(), lists[b].end());
+		std::vector<int>().swap(lists[b]);
+	}
+}
+
+
+void VisibilityIndex::Clear() {
+	std::vector<size_t>().swap(start);
+	std::vector<int>().swap(vertices);
+	blocksX = blocksY = 0;
+}
+
+
+size_t VisibilityIndex::byte_size() const {
+	return start.size()*sizeof(size_t) + vertices.size()*sizeof(int);
+}
@@ -0,0 +1,115 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISIBILITYINDEX_H
+#define VISIBILITYINDEX_H
+
+#include <vector>
+#include <iostream>
+#include "../bitmap/bitmap.h"
+#include "../location/location.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+/** Lists, for each square block of pixels, the vertices that may have line
+	of sight to some pixel of the block.
+
+	Each vertex's visible pixels are found with VisibilitySweep::VisibleSpans,
+	so a block's list holds every vertex with line of sight to any of its 
+	pixels, and perhaps a few that only graze an obstacle; a caller still
+	checks each with bitmap::HasLineOfSight. Lists are kept in increasing 
+	vertex order, one after another in a single array.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class VisibilityIndex {
+
+	private:
+
+		int blockSize;
+		int blocksX, blocksY;
+		std::vector<size_t> start;     // block b's list is [start[b], start[b+1])
+		std::vector<int> vertices;     // indices into the vertex vector
+
+		size_t Block(const location& a) const 
+			{ return (size_t)(a.y / blockSize)*blocksX + a.x / blockSize; }
+
+		const int* Data() const 
+			{ return vertices.empty() ? 0 : &vertices[0]; }
+
+	public:
+
+		/////////////////////////////////////////////////////
+		/** @name Constructors **/
+		//@{
+
+		VisibilityIndex() : blockSize(1), blocksX(0), blocksY(0) { }
+
+		//@}
+
+
+		/////////////////////////////////////////////////////
+		/** @name Public Members **/
+		//@{
+
+		/** Indexes #verts# over #blockSize# square blocks of #bm#, 
+			replacing any earlier index.
+			@precondition bm->BuildPassabilityGrid() has been called. */
+		void Build(bitmap* bm, const std::vector<location>& verts, 
+			int blockSize, std::ostream& out);
+
+		/** Forgets the index. */
+		void Clear();
+
+		bool Empty() const { return start.empty(); }
+
+		/** True if #a# is a pixel of the indexed image. */
+		bool Covers(const location& a) const {
+			return !Empty() && a.x >= 0 && a.y >= 0 && 
+				a.x < blocksX*blockSize && a.y < blocksY*blockSize;
+		}
+
+		/** The indices of the vertices that may see #a#. 
+			@precondition Covers(#a#) */
+		const int* Begin(const location& a) const 
+			{ return Data() + start[Block(a)]; }
+		const int* End(const location& a) const 
+			{ return Data() + start[Block(a)+1]; }
+
+		/** Bytes held by the index. */
+		size_t byte_size() const;
+
+		//@}
+};
+
+#endif
@@ -0,0 +1,227 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "VisibilitySweep.h"
+#include <algorithm>
+
+VisibilitySweep::VisibilitySweep
+(bitmap* bm, const location::Set& G, bool allRows) {
+
+	firstRow = 0;
+	width = 0;
+	height = 0;
+	if (G.empty()) return;
+
+	const PassabilityGrid& grid = bm->Grid();
+	width  = grid.GetWidth();
+	height = grid.GetHeight();
+
+	int minY = G.begin()->y;
+	int maxY = minY;
+	for (location::ConstSetIter v = G.begin(); v != G.end(); v++) {
+		minY = std::min(minY, v->y);
+		maxY = std::max(maxY, v->y);
+	}
+
+	// The grid is readable one row beyond the image on either side.
+	if (allRows) {
+		minY = std::max(std::min(minY, 0), -1);
+		maxY = std::min(std::max(maxY, height-1), height);
+	}
+
+	firstRow = minY;
+	runs.resize(maxY - minY + 1);
+	verts.resize(maxY - minY + 1);
+
+	// G is ordered by x, so each row's vertices are too.
+	for (location::ConstSetIter v = G.begin(); v != G.end(); v++) {
+		if (v->y >= minY && v->y <= maxY) verts[v->y - minY].push_back(v->x);
+	}
+
+	// A run can only separate two vertices from a row strictly between 
+	// theirs, but a pixel may be in any row.
+	int runFirst = allRows ? minY : minY+1;
+	int runLast  = allRows ? maxY : maxY-1;
+	for (int y = runFirst; y <= runLast; y ++) {
+		std::vector<Run>& row = runs[y - minY];
+		int x = 0;
+		while (x < width) {
+			if (grid(x,y)) { x ++; continue; }
+			int x0 = x;
+			while (x < width && !grid(x,y)) x ++;
+			row.push_back(Run(x0, x-1));
+		}
+	}
+}
+
+
+size_t VisibilitySweep::RunCount() const {
+	size_t count = 0;
+	for (size_t y = 0; y < runs.size(); y ++) count += runs[y].size();
+	return count;
+}
+
+
+void VisibilitySweep::Candidates(location v, location::Vector& out) const {
+
+	if (v.y < firstRow || v.y - firstRow >= (int)verts.size()) return;
+
+	// v itself, then the rest of its row; those share the row with the 
+	// runs between them, so are left to the caller's line of sight test.
+	const std::vector<int>& row = VertsOf(v.y);
+	std::vector<int>::const_iterator x = 
+		std::lower_bound(row.begin(), row.end(), v.x);
+	for (; x != row.end(); x++) out.push_back(location(*x, v.y));
+
+	// Vertices directly above v are ordered after it; those below, before.
+	std::vector<View> view, cut;
+	Sweep(v,  1, true,  view, cut, out);
+	Sweep(v, -1, false, view, cut, out);
+}
+
+
+void VisibilitySweep::Sweep(location v, int step, bool withColumn, 
+	std::vector<View>& view, std::vector<View>& cut, 
+	location::Vector& out) const {
+
+	view.clear();
+	view.push_back(View(Slope(0,1), Slope(1,0)));
+
+	int firstX = withColumn ? v.x : v.x+1;
+
+	for (int y = v.y + step, dy = 1; 
+		y >= firstRow && y - firstRow < (int)verts.size() && !view.empty(); 
+		y += step, dy ++) {
+
+		// Report the row's vertices still in view. Vertex x lies in
+		// direction (x - v.x) / dy.
+		const std::vector<int>& vrow = VertsOf(y);
+		std::vector<int>::const_iterator x = 
+			std::lower_bound(vrow.begin(), vrow.end(), firstX);
+		for (size_t i = 0; i < view.size() && x != vrow.end(); ) {
+			Slope s(*x - v.x, dy);
+			if      (s < view[i].lo)   x++;
+			else if (view[i].hi < s)   i++;
+			else    { out.push_back(location(*x, y)); x++; }
+		}
+
+		if (RunsOf(y).empty()) continue;
+		Cut(v, y, dy, view, cut);
+		view.swap(cut);
+	}
+}
+
+
+// Cuts each run's directions, the open interval from (x0 - 1/2) / dy to 
+// (x1 + 1/2) / dy, out of the view.
+void VisibilitySweep::Cut(location v, int y, int dy, 
+	const std::vector<View>& view, std::vector<View>& cut) const {
+
+	const std::vector<Run>& rrow = RunsOf(y);
+
+	cut.clear();
+	size_t first = 0;
+	for (size_t i = 0; i < view.size(); i ++) {
+		View w = view[i];
+		bool open = true;
+
+		// Runs left of this interval are left of the rest too.
+		while (first < rrow.size() && 
+			Slope(2*(rrow[first].x1 - v.x) + 1, 2*dy) <= w.lo) first ++;
+
+		for (size_t r = first; r < rrow.size(); r ++) {
+			Slope p(2*(rrow[r].x0 - v.x) - 1, 2*dy);
+			Slope q(2*(rrow[r].x1 - v.x) + 1, 2*dy);
+			if (w.hi <= p) break;
+			if (w.lo <= p) cut.push_back(View(w.lo, p));
+			if (w.hi < q) { open = false; break; }
+			w.lo = q;
+		}
+		if (open) cut.push_back(w);
+	}
+}
+
+
+// Smallest x with s <= x / dy, or largest with x / dy <= s when !up.
+static long SlopeToX(long n, long d, long dy, bool up) {
+	long a = n*dy;
+	long q = a / d;
+	if (q*d != a && ((a < 0) != up)) q += up ? 1 : -1;
+	return q;
+}
+
+
+void VisibilitySweep::VisibleSpans
+(location v, std::vector<Span>& out) const {
+
+	if (v.y < firstRow || v.y - firstRow >= (int)runs.size()) return;
+
+	// v's own row, out to the nearest impassible pixel either side. 
+	if (v.y >= 0 && v.y < height) {
+		const std::vector<Run>& rrow = RunsOf(v.y);
+		int x0 = 0;
+		int x1 = width-1;
+		for (size_t r = 0; r < rrow.size(); r ++) {
+			if (rrow[r].x1 < v.x) x0 = rrow[r].x1 + 1;
+			else if (rrow[r].x0 > v.x) { x1 = rrow[r].x0 - 1; break; }
+			else { x1 = x0 - 1; break; }
+		}
+		if (x0 <= x1) out.push_back(Span(v.y, x0, x1));
+	}
+
+	std::vector<View> view, cut;
+	for (int step = -1; step <= 1; step += 2) {
+		view.clear();
+		view.push_back(View(Slope(-1,0), Slope(1,0)));
+
+		for (int y = v.y + step, dy = 1; 
+			y >= firstRow && y - firstRow < (int)runs.size() && 
+			!view.empty(); y += step, dy ++) {
+
+			// Report the row's pixels still in view, then cut its runs.
+			if (y >= 0 && y < height)
+			for (size_t i = 0; i < view.size(); i ++) {
+				long x0 = 0;
+				long x1 = width-1;
+				if (view[i].lo.d) x0 = std::max(x0, 
+					v.x + SlopeToX(view[i].lo.n, view[i].lo.d, dy, true));
+				if (view[i].hi.d) x1 = std::min(x1, 
+					v.x + SlopeToX(view[i].hi.n, view[i].hi.d, dy, false));
+				if (x0 <= x1) out.push_back(Span(y, x0, x1));
+			}
+
+			if (RunsOf(y).empty()) continue;
+			Cut(v, y, dy, view, cut);
+			view.swap(cut);
+		}
+	}
+}
@@ -0,0 +1,163 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISIBILITYSWEEP_H
+#define VISIBILITYSWEEP_H
+
+#include <vector>
+#include "../bitmap/bitmap.h"
+#include "../location/location.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+/** Angular sweep filter for visibility graph construction.
+
+	Obstacles are taken from the bitmap's passability grid as horizontal 
+	runs of impassible pixels, each run standing for the open segment 
+	through its pixels' centers. If the segment from one pixel center to 
+	another properly crosses such a run, the Bresenham line between the two 
+	pixels visits a pixel of that run, so the two cannot see one another.
+
+	From each source vertex the sweep keeps the set of directions, as 
+	closed intervals of slope, not yet cut off by a run. It moves away from 
+	the source a row at a time, first reporting the vertices of the row 
+	whose direction is still open, then cutting the row's runs out of the 
+	set, and stops once the set is empty. Only the runs and vertices within 
+	the source's remaining view are ever touched.
+
+	The vertices returned by #Candidates# are a superset of those with line 
+	of sight to the source; each must still be checked with 
+	bitmap::HasLineOfSight, which is then only paid for the few vertices 
+	that graze an obstacle rather than for every pair. #VisibleSpans# 
+	sweeps the same way over every pixel rather than over the vertices.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class VisibilitySweep {
+
+	private:
+
+		// A horizontal run of impassible pixels, x0 through x1.
+		struct Run {
+			Run(int _x0, int _x1) : x0(_x0), x1(_x1) { }
+			int x0, x1;
+		};
+
+		// The slope n/d of a direction from the source, in x per row away
+		// from it. d == 0 stands for an infinite slope of n's sign.
+		struct Slope {
+			Slope() : n(0), d(1) { }
+			Slope(long _n, long _d) : n(_n), d(_d) { }
+			bool operator< (const Slope& s) const {
+				if (d == 0 || s.d == 0) return Infinity() < s.Infinity();
+				return n*s.d < s.n*d;
+			}
+			int Infinity() const { return d ? 0 : (n < 0 ? -1 : 1); }
+			bool operator<= (const Slope& s) const { return !(s < *this); }
+			long n, d;
+		};
+
+		// A closed interval of open directions.
+		struct View {
+			View(Slope _lo, Slope _hi) : lo(_lo), hi(_hi) { }
+			Slope lo, hi;
+		};
+
+		int firstRow;
+		int width, height;                       // of the image
+		std::vector< std::vector<Run> > runs;    // by row, ordered by x
+		std::vector< std::vector<int> > verts;   // vertex x's, by row
+
+		// Sweeps the rows from #v# in direction #step# (1 or -1), 
+		// appending to #out# the vertices right of #v#, or directly 
+		// above it when #withColumn#, that are left in view. #view# and
+		// #cut# are scratch space.
+		void Sweep(location v, int step, bool withColumn, 
+			std::vector<View>& view, std::vector<View>& cut,
+			location::Vector& out) const;
+
+		// Leaves in #cut# what is left of #view# from #v# after cutting 
+		// out row #y#'s runs, #dy# rows away.
+		void Cut(location v, int y, int dy, const std::vector<View>& view,
+			std::vector<View>& cut) const;
+
+		const std::vector<Run>& RunsOf(int y) const 
+			{ return runs[y - firstRow]; }
+		const std::vector<int>& VertsOf(int y) const 
+			{ return verts[y - firstRow]; }
+
+	public:
+
+		/////////////////////////////////////////////////////
+		/** @name Constructors **/
+		//@{
+
+		/** Collects the vertices of #G# and the impassible runs of #bm# 
+			between the first and last rows holding a vertex, or of every
+			row of the image when #allRows#, as #VisibleSpans# needs. 
+			@precondition bm->BuildPassabilityGrid() has been called. */
+		VisibilitySweep(bitmap* bm, const location::Set& G, 
+			bool allRows = false);
+
+		//@}
+
+
+		/////////////////////////////////////////////////////
+		/** @name Public Members **/
+		//@{
+
+		/** Appends to #out# #v# itself and every vertex ordered after #v# 
+			in the set given to the constructor that no impassible run 
+			hides from #v#. Each later vertex with line of sight to #v# is 
+			among them. May be called from several threads at once. */
+		void Candidates(location v, location::Vector& out) const;
+
+		/** Pixels x0 through x1 of row y. */
+		struct Span {
+			Span(int _y, int _x0, int _x1) : y(_y), x0(_x0), x1(_x1) { }
+			int y, x0, x1;
+		};
+
+		/** Appends to #out# spans covering every pixel of the image that 
+			no impassible run hides from #v#, a superset of those with 
+			line of sight to #v#.
+			@precondition constructed with #allRows#. */
+		void VisibleSpans(location v, std::vector<Span>& out) const;
+
+		/** Number of impassible runs considered by the sweep. */
+		size_t RunCount() const;
+
+		//@}
+};
+
+#endif
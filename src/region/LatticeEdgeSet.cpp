@@ -0,0 +1,255 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LatticeEdgeSet.h"
+#include <pthread.h>
+#include <algorithm>
+
+typedef LatticeEdgeSet::word word;
+
+// Transposes a 64 by 64 block of bits in place: bit j of word k becomes
+// bit k of word j. Six rounds swap ever smaller sub-blocks across the 
+// diagonal.
+static void Transpose(word block[64])
+{
+    word mask = 0x00000000FFFFFFFFULL;
+    for (int j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            word t = ((block[k] >> j) ^ block[k | j]) & mask;
+            block[k]     ^= t << j;
+            block[k | j] ^= t;
+        }
+    }
+}
+
+
+// Moves the low 32 bits of v to the even bits of the result.
+static inline word Spread(word v)
+{
+    v &= 0x00000000FFFFFFFFULL;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+    v = (v | (v <<  8)) & 0x00FF00FF00FF00FFULL;
+    v = (v | (v <<  4)) & 0x0F0F0F0F0F0F0F0FULL;
+    v = (v | (v <<  2)) & 0x3333333333333333ULL;
+    v = (v | (v <<  1)) & 0x5555555555555555ULL;
+    return v;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// State shared by every worker of LatticeEdgeSet::Build. The first 
+// phase transposes the passability grid into pixel columns, a grid word 
+// (64 columns) per chunk; the second turns pixel columns into lattice 
+// columns, 64 of them per chunk. Each chunk writes only its own columns.
+// The next chunk, the tallies and the output stream are guarded by lock.
+struct LatticeShared
+{
+    const PassabilityGrid& grid;
+    int width;
+    int height;
+    int colWords;               // words per pixel column
+    std::vector<word>& columns; // pixel column i holds x = i-1
+    word* bits;                 // the set's bits, 2*colWords words per x
+    std::ostream& out;
+
+    pthread_mutex_t lock;
+    int phase;
+    int chunks;
+    int next;
+    int completed;
+    size_t count;
+
+    LatticeShared(const PassabilityGrid& _grid, int _colWords, 
+        std::vector<word>& _columns, word* _bits, std::ostream& _out) :
+        grid(_grid), width(_grid.GetWidth()), height(_grid.GetHeight()),
+        colWords(_colWords), columns(_columns), bits(_bits), out(_out),
+        phase(0), chunks(0), next(0), completed(0), count(0)
+    { pthread_mutex_init(&lock, NULL); }
+
+    ~LatticeShared() { pthread_mutex_destroy(&lock); }
+};
+
+
+// Fills the pixel columns held by grid word #wi#: bit y of column i 
+// is pixel (i-1,y).
+static void TransposeColumns(LatticeShared& sh, int wi)
+{
+    word block[64];
+    for (int rb = 0; rb < sh.colWords; rb ++) {
+        for (int k = 0; k < 64; k ++) {
+            int y = rb*64 + k;
+            block[k] = (y < sh.height) ? sh.grid.Row(y)[wi] : 0;
+        }
+        Transpose(block);
+        for (int j = 0; j < 64; j ++)
+            sh.columns[(size_t)(wi*64 + j)*sh.colWords + rb] = block[j];
+    }
+}
+
+
+// Fills lattice columns [64*chunk, 64*chunk+64) and returns the number of
+// edges in them. Even lattice bit 2r is pixel (x,r-1) against (x,r); odd
+// bit 2r+1 is pixel (x-1,r) against (x,r).
+static size_t LatticeColumns(LatticeShared& sh, int chunk)
+{
+    const int  last = std::min(64*(chunk+1), sh.width);
+    const word lastMask = (sh.height % 64) ? 
+        ((word)1 << (sh.height % 64)) - 1 : ~(word)0;
+    size_t count = 0;
+
+    for (int x = 64*chunk; x < last; x ++) {
+        const word* left = &sh.columns[(size_t)x*sh.colWords];
+        const word* here = &sh.columns[(size_t)(x+1)*sh.colWords];
+        word* out = sh.bits + (size_t)x*2*sh.colWords;
+        word carry = 0;
+
+        for (int w = 0; w < sh.colWords; w ++) {
+            word c = here[w];
+            word ySteps = c ^ ((c << 1) | carry);
+            word xSteps = left[w] ^ c;
+            carry = c >> 63;
+
+            // No edge below the last row; SquareLatticeWalker never 
+            // scanned for one.
+            if (w == sh.colWords-1) ySteps &= lastMask;
+
+            out[2*w]   = Spread(ySteps)       | (Spread(xSteps)       << 1);
+            out[2*w+1] = Spread(ySteps >> 32) | (Spread(xSteps >> 32) << 1);
+            count += __builtin_popcountll(out[2*w]) + 
+                     __builtin_popcountll(out[2*w+1]);
+        }
+    }
+    return count;
+}
+
+
+// Does the current phase's chunks until none are left.
+static void* LatticeWorker(void* arg)
+{
+    LatticeShared& sh = *static_cast<LatticeShared*>(arg);
+
+    for (;;)
+    {
+        pthread_mutex_lock(&sh.lock);
+        int chunk = sh.next ++;
+        pthread_mutex_unlock(&sh.lock);
+
+        if (chunk >= sh.chunks) break;
+
+        if (sh.phase == 0) TransposeColumns(sh, chunk);
+        else {
+            size_t count = LatticeColumns(sh, chunk);
+            pthread_mutex_lock(&sh.lock);
+            sh.count += count;
+            sh.completed ++;
+            sh.out << (sh.completed*100)/sh.chunks << "%  \r";
+            sh.out.flush();
+            pthread_mutex_unlock(&sh.lock);
+        }
+    }
+
+    return 0;
+}
+
+
+// Runs #chunks# chunks of phase #phase# on #numThreads# threads, the 
+// calling thread among them.
+static void RunPhase(LatticeShared& sh, int phase, int chunks, 
+    int numThreads)
+{
+    sh.phase  = phase;
+    sh.chunks = chunks;
+    sh.next   = 0;
+
+    std::vector<pthread_t> threads(numThreads);
+    int started = 1;
+    for (; started < numThreads; started++) {
+        if (pthread_create(&threads[started], NULL, 
+            LatticeWorker, &sh) != 0) {
+            std::cerr << "Could not start worker thread " 
+                << started << ".\n";
+            break;
+        }
+    }
+    LatticeWorker(&sh);
+    for (int t = 1; t < started; t++) pthread_join(threads[t], NULL);
+}
+
+
+void LatticeEdgeSet::Build(const PassabilityGrid& grid, int numThreads, 
+    std::ostream& out)
+{
+    int colWords = (grid.GetHeight() + 63) / 64;
+
+    width  = grid.GetWidth();
+    height = 2*grid.GetHeight();
+    stride = 2*colWords;
+    bits.assign((size_t)width*stride, 0);
+    count  = 0;
+    cursor = 0;
+
+    if (bits.empty()) return;
+    if (numThreads < 1) numThreads = 1;
+
+    std::vector<word> columns((size_t)grid.GetStride()*64*colWords);
+    LatticeShared shared(grid, colWords, columns, &bits[0], out);
+
+    RunPhase(shared, 0, grid.GetStride(), numThreads);
+    RunPhase(shared, 1, (width + 63) / 64, numThreads);
+
+    count = shared.count;
+}
+
+
+location LatticeEdgeSet::First()
+{
+    while (bits[cursor] == 0) cursor ++;
+    return location(cursor / stride, 
+        (cursor % stride)*64 + __builtin_ctzll(bits[cursor]));
+}
+
+
+bool LatticeEdgeSet::Next(location& edge, int xEnd) const
+{
+    size_t w   = (size_t)edge.x*stride + (edge.y >> 6);
+    size_t end = (size_t)std::min(xEnd, width)*stride;
+    if (edge.x < 0 || w >= end) return false;
+
+    word b = bits[w] & (~(word)0 << (edge.y & 63));
+    while (b == 0) {
+        if (++ w >= end) return false;
+        b = bits[w];
+    }
+
+    edge = location(w / stride, (w % stride)*64 + __builtin_ctzll(b));
+    return true;
+}
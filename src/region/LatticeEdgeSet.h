@@ -0,0 +1,125 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATTICE_EDGE_SET_H
+#define LATTICE_EDGE_SET_H
+
+#include <vector>
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+#include "../bitmap/passability_grid.h"
+#include "../location/location.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+/**	The set of lattice edges that separate a passible pixel from an 
+	impassible one, one bit per lattice edge. Lattice edge (x,y) with y odd
+	lies between pixels (x-1,(y-1)/2) and (x,(y-1)/2); with y even, between
+	(x,y/2-1) and (x,y/2). Edges cover x < width and y < 2*height of the
+	image, as SquareLatticeWalker has always scanned them.
+
+	Bits are kept x after x, y after y within an x, so the first set bit 
+	is the least edge in location order and the set can stand in for the 
+	std::set<location> SquareLatticeWalker once used. Edges are only ever 
+	erased after Build, so First() resumes its search where it last stopped.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class LatticeEdgeSet {
+
+	public:
+		typedef uint64_t word;
+
+	private:
+		int width;                  // lattice x in [0,width)
+		int height;                 // lattice y in [0,height)
+		int stride;                 // words per x
+		std::vector<word> bits;
+		size_t count;
+		size_t cursor;              // no bit is set in a word before this
+
+	public:
+
+		/////////////////////////////////////////////////////
+		/** @name Constructors **/
+		//@{
+
+		LatticeEdgeSet() : width(0), height(0), stride(0), count(0), 
+			cursor(0) { }
+
+		//@}
+
+
+		/////////////////////////////////////////////////////
+		/** @name Public Members **/
+		//@{
+
+		/** Finds every lattice edge of #grid#'s image, a word of edges at 
+			a time, sharing the image's columns among #numThreads# 
+			threads. Progress goes to #out#. */
+		void Build(const PassabilityGrid& grid, int numThreads, 
+			std::ostream& out);
+
+		/** True if lattice edge (#x#,#y#) is in the set. */
+		bool Contains(int x, int y) const {
+			if ((unsigned)x >= (unsigned)width || 
+				(unsigned)y >= (unsigned)height) return false;
+			return (bits[(size_t)x*stride + (y >> 6)] >> (y & 63)) & 1;
+		}
+
+		/** Removes lattice edge (#x#,#y#), if it is in the set. */
+		void Erase(int x, int y) {
+			if (!Contains(x,y)) return;
+			bits[(size_t)x*stride + (y >> 6)] &= ~((word)1 << (y & 63));
+			count --;
+		}
+
+		void Erase(const location& edge) { Erase(edge.x, edge.y); }
+
+		/** The least edge in the set, x's compared first.
+			@precondition the set is not empty. */
+		location First();
+
+		/** Moves #edge# to the least edge at or after it with x before 
+			#xEnd#, returning false if there is none. 
+			@precondition 0 <= #edge#.y < 2*height of the image. */
+		bool Next(location& edge, int xEnd) const;
+
+		bool Empty() const { return count == 0; }
+		size_t size() const { return count; }
+
+		//@}
+};
+
+#endif
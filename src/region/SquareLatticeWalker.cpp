@@ -1,5 +1,7 @@
 #include "SquareLatticeWalker.h"
 #include <assert.h>
+#include <pthread.h>
+#include <algorithm>
 
 static const char RFL[4]  = { 'R', 'F', 'L' };
 static const char WENS[4] = { 'W', 'E', 'N', 'S' };
@@ -36,28 +38,19 @@ SquareLatticeWalker::SquareLatticeWalker(bitmap* _bmp, std::ostream& out)
 }
 
 
-void SquareLatticeWalker::initialize(bitmap* _bmp, std::ostream& out)
+void SquareLatticeWalker::initialize
+(bitmap* _bmp, std::ostream& out, int numThreads)
 {
     bmp = _bmp;
     
     // Initialize connected
-    for (int x = 0; x <= bmp->max().x; x ++) 
-    {
-        out << ((x+1)*100)/bmp->GetWidth() << "%  \r";
-        out.flush();
-            
-        for (int y = 0; y <= bmp->max().y*2+1; y ++) 
-        {
-            if (bmp->IsConnectedLatticeEdge(x,y))
-                connected.insert(latticeEdge(x,y));
-        }
-    }
+    connected.Build(bmp->Grid(), numThreads, out);
 }
 
 
 bool SquareLatticeWalker::HasNext()
 {
-    return connected.size() > 0;
+    return !connected.Empty();
 }
 
 
@@ -65,51 +58,226 @@ void SquareLatticeWalker::ProcessNextBoundary()
 {
     if (!HasNext()) return;
     
-    boundaryList.clear();
-    rellist.clear();
+    Trace trace;
+    TraceBoundary(connected.First(), trace);
+    Erase(trace);
 
-    latticeEdge firstEdge = *connected.begin();
-    latticeEdge nextEdge  = firstEdge;
-    AbsDir nextAbsDir = W;
+    relword.swap(trace.relword);
+    absword.swap(trace.absword);
+    boundary.swap(trace.boundary);
+}
 
-    if (HasNext()) {
-        FindNextLatticeEdge(nextEdge, nextAbsDir);
-        connected.erase(nextEdge);
-    }
 
-//    rellist.push_back('F');
-    boundaryList.push_back(bmp->ExternalCellLocation(nextEdge));
-//    connected.erase(nextEdge);
+bool SquareLatticeWalker::TraceBoundary
+(latticeEdge firstEdge, Trace& trace, LatticeEdgeSet* unwalked) const
+{
+    trace.seed = firstEdge;
+    trace.relword.clear();
+    trace.absword.clear();
+    trace.boundary.clear();
+    trace.edges.clear();
+
+    latticeEdge nextEdge = firstEdge;
+    AbsDir nextAbsDir = W;
+
+    if (!Step(nextEdge, nextAbsDir, trace, unwalked)) return false;
+    trace.boundary.push_back(bmp->ExternalCellLocation(nextEdge));
     
     do {
-        
-        FindNextLatticeEdge(nextEdge, nextAbsDir);
-        connected.erase(nextEdge);
-        
-    } while (nextEdge != firstEdge && HasNext());
-    
-//    if (HasNext()) {
-//        FindNextLatticeEdge(nextEdge, nextAbsDir);
-//        connected.erase(nextEdge);
-//    }
+        if (!Step(nextEdge, nextAbsDir, trace, unwalked)) return false;
+    } while (nextEdge != firstEdge);
 
-//    if (rellist.size() < boundaryList.size()) {
-//        boundaryList.pop_front();
-//    }
+    return true;
+}
 
-    relword.clear();
-    relword.insert(relword.begin(), rellist.begin(), rellist.end());
-    
-    absword.clear();
-    absword.insert(absword.begin(), abslist.begin(), abslist.end());
-    
-    boundary.clear();
-    boundary.insert(boundary.begin(), boundaryList.begin(), boundaryList.end());
+
+bool SquareLatticeWalker::Step
+(latticeEdge &nextEdge, AbsDir &nextAbsDir, Trace &trace, 
+LatticeEdgeSet* unwalked) const
+{
+    bool found = FindNextLatticeEdge(nextEdge, nextAbsDir, trace);
+    assert(found || unwalked);
+    if (!found) return false;
+
+    // A speculative trace that reaches another boundary's seed, or an 
+    // edge this worker has walked before, was not started from a seed.
+    if (unwalked && nextEdge != trace.seed && 
+        connected.Contains(nextEdge.x, nextEdge.y)) {
+        if (nextEdge < trace.seed || 
+            !unwalked->Contains(nextEdge.x, nextEdge.y)) return false;
+        unwalked->Erase(nextEdge);
+    }
+
+    trace.edges.push_back(nextEdge);
+    return true;
+}
+
+
+void SquareLatticeWalker::Erase(const Trace& trace)
+{
+    for (size_t i = 0; i < trace.edges.size(); i ++)
+        connected.Erase(trace.edges[i]);
+    connected.Erase(trace.seed);
+}
+
+
+void SquareLatticeWalker::Trace::swap(Trace& other)
+{
+    std::swap(seed, other.seed);
+    relword.swap(other.relword);
+    absword.swap(other.absword);
+    boundary.swap(other.boundary);
+    edges.swap(other.edges);
+}
+
+
+// Lattice columns handed to a tracing worker at a time.
+#define TRACE_STRIP 64
+
+///////////////////////////////////////////////////////////////////////
+// State shared by every worker of SquareLatticeWalker::TraceAll. The 
+// walker and its edges are only read. The next strip to claim, the tally
+// and the output stream are guarded by lock.
+struct TraceShared
+{
+    const SquareLatticeWalker& walker;
+    const LatticeEdgeSet& connected;
+    int strips;
+    std::ostream& out;
+
+    pthread_mutex_t lock;
+    int next;
+    int completed;
+
+    TraceShared(const SquareLatticeWalker& _walker, 
+        const LatticeEdgeSet& _connected, int _strips, std::ostream& _out) :
+        walker(_walker), connected(_connected), strips(_strips), out(_out),
+        next(0), completed(0)
+    { pthread_mutex_init(&lock, NULL); }
+
+    ~TraceShared() { pthread_mutex_destroy(&lock); }
+};
+
+struct TraceWorker
+{
+    TraceShared* shared;
+    SquareLatticeWalker::TraceList found;
+};
+
+
+///////////////////////////////////////////////////////////////////////
+// Traces boundaries from the edges of the strips handed out by the 
+// shared counter until none are left. Within a strip each boundary is 
+// first met at its least edge there. If that is not its least edge 
+// overall, the boundary belongs to an earlier strip, and the trace is 
+// abandoned as soon as it finds a lesser edge. The worker's own copy of 
+// the edges loses every edge it walks, so it walks no edge twice.
+static void* TraceStrips(void* arg)
+{
+    TraceWorker& w = *static_cast<TraceWorker*>(arg);
+    TraceShared& sh = *w.shared;
+
+    LatticeEdgeSet unwalked(sh.connected);
+    SquareLatticeWalker::Trace trace;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&sh.lock);
+        int strip = sh.next ++;
+        pthread_mutex_unlock(&sh.lock);
+
+        if (strip >= sh.strips) break;
+
+        location seed(TRACE_STRIP*strip, 0);
+        while (unwalked.Next(seed, TRACE_STRIP*(strip+1))) {
+            bool whole = sh.walker.TraceBoundary(seed, trace, &unwalked);
+            unwalked.Erase(seed);
+
+            if (whole) {
+                w.found.push_back(SquareLatticeWalker::Trace());
+                w.found.back().swap(trace);
+            }
+        }
+
+        pthread_mutex_lock(&sh.lock);
+        sh.completed ++;
+        sh.out << sh.completed << " / " << sh.strips 
+            << " strips traced...  \r";
+        sh.out.flush();
+        pthread_mutex_unlock(&sh.lock);
+    }
+
+    return 0;
+}
+
+
+static bool SeedLess
+(const SquareLatticeWalker::Trace* a, const SquareLatticeWalker::Trace* b)
+{
+    return a->seed < b->seed;
+}
+
+
+void SquareLatticeWalker::TraceAll
+(TraceList& traces, int numThreads, std::ostream& out)
+{
+    if (numThreads < 1) numThreads = 1;
+
+    int strips = (bmp->GetWidth() + TRACE_STRIP-1) / TRACE_STRIP;
+    TraceShared shared(*this, connected, strips, out);
+    std::vector<TraceWorker> workers(numThreads);
+    std::vector<pthread_t> threads(numThreads);
+
+    for (int t = 0; t < numThreads; t++) workers[t].shared = &shared;
+
+    // Thread 0 is the calling thread.
+    int started = 1;
+    for (; started < numThreads; started++) {
+        if (pthread_create(&threads[started], NULL, 
+            TraceStrips, &workers[started]) != 0) {
+            std::cerr << "Could not start worker thread " 
+                << started << ".\n";
+            break;
+        }
+    }
+    TraceStrips(&workers[0]);
+    for (int t = 1; t < started; t++) pthread_join(threads[t], NULL);
+
+    std::vector<Trace*> bySeed;
+    for (int t = 0; t < numThreads; t++)
+        for (size_t i = 0; i < workers[t].found.size(); i ++)
+            bySeed.push_back(&workers[t].found[i]);
+    std::sort(bySeed.begin(), bySeed.end(), SeedLess);
+
+    // Take the boundaries in ProcessNextBoundary's order: each from the 
+    // least edge left. Its trace is nearly always among the workers'; 
+    // any other is walked here.
+    Trace key;
+    size_t retraced = 0;
+    while (HasNext()) {
+        key.seed = connected.First();
+        traces.push_back(Trace());
+        Trace& trace = traces.back();
+
+        std::vector<Trace*>::iterator found = 
+            std::lower_bound(bySeed.begin(), bySeed.end(), &key, SeedLess);
+        if (found != bySeed.end() && (*found)->seed == key.seed) 
+            trace.swap(**found);
+        else {
+            TraceBoundary(key.seed, trace);
+            retraced ++;
+        }
+
+        Erase(trace);
+    }
+
+    out << traces.size() << " boundaries traced; " << retraced 
+        << " had to be traced again in order.\n";
 }
 
 
-void SquareLatticeWalker::FindNextLatticeEdge
-(latticeEdge &nextEdge, AbsDir &nextAbsDir)
+bool SquareLatticeWalker::FindNextLatticeEdge
+(latticeEdge &nextEdge, AbsDir &nextAbsDir, Trace &trace) const
 {
     for (int offsetIndex = R; offsetIndex <= L; offsetIndex ++)
     {
@@ -152,12 +320,12 @@ void SquareLatticeWalker::FindNextLatticeEdge
             // II.b (b)
             // Did we skip an outside corner?
             // If so, we need to account for this by adding nextEdge + (D) to 
-            // boundaryList and 'F' to rellist (and updating indexMap).
+            // trace.boundary and 'F' to trace.relword (and updating indexMap).
             if (bmp->IsPassible(checkFar) && offsetIndex != F)
             {
-                boundaryList.push_back
+                trace.boundary.push_back
                     (bmp->LatticeToCell(check.farCorner + nextEdge));
-                rellist.push_back('F');
+                trace.relword += 'F';
             }
             
             // set next edge and direction
@@ -166,20 +334,20 @@ void SquareLatticeWalker::FindNextLatticeEdge
             
             // II.b
             // store relative letter and boundary location
-            rellist.push_back(RFL[offsetIndex]);
-            abslist.push_back(WENS[nextAbsDir]);
-            boundaryList.push_back(checkLoc);
+            trace.relword += RFL[offsetIndex];
+            trace.absword += WENS[nextAbsDir];
+            trace.boundary.push_back(checkLoc);
             
-            return;          
+            return true;          
         }
     }
     
     // Failed to find the next lattice edge.
-    assert(false);
+    return false;
 }
 
 
-bool SquareLatticeWalker::IsACorner(location loc)
+bool SquareLatticeWalker::IsACorner(location loc) const
 {
     const location corner[4] = { 
         location(0,0), location(bmp->max().x,0), 
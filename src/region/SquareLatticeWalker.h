@@ -2,11 +2,12 @@
 #define SQUARELATTICEWALKER_H
 
 #include "../bitmap/bitmap.h"
+#include "LatticeEdgeSet.h"
 #include <iostream>
 #include <string>
 #include <vector>
 #include <list>
-#include <set>
+#include <deque>
 
 enum Offset { R, F, L };
 enum AbsDir { W, E, N, S };
@@ -14,10 +15,28 @@ enum AbsDir { W, E, N, S };
 class SquareLatticeWalker
 {
     
+public:
+
+    // Types:
+    typedef location latticeEdge;
+
+    // One boundary as traced from its seed, the least lattice edge on it.
+    struct Trace
+    {
+        latticeEdge seed;
+        std::string relword;
+        std::string absword;
+        location::Vector boundary;
+        std::vector<latticeEdge> edges;     // every edge walked, seed last
+
+        void swap(Trace&);
+    };
+
+    typedef std::deque<Trace> TraceList;
+
 private:
     
     // Types:
-    typedef location latticeEdge;
     typedef location offst;
             
     struct LatticeDir
@@ -35,10 +54,7 @@ private:
     bitmap* bmp;
     
     // Temporary Storage:
-    std::list<char> rellist;
-    std::list<char> abslist;
-    std::set<latticeEdge> connected;
-    location::List boundaryList;
+    LatticeEdgeSet connected;
     
     // Outputs:
     std::string relword;
@@ -46,17 +62,33 @@ private:
     location::Vector boundary;
 
     // Private Methods:
-    void FindNextLatticeEdge(latticeEdge &, AbsDir &);
-    bool IsACorner(location);
+    bool FindNextLatticeEdge(latticeEdge &, AbsDir &, Trace &) const;
+    bool Step(latticeEdge &, AbsDir &, Trace &, LatticeEdgeSet*) const;
+    bool IsACorner(location) const;
+    void Erase(const Trace&);
 
 public:
 
     // Public Methods
     SquareLatticeWalker();
     SquareLatticeWalker(bitmap*, std::ostream&);
-    void initialize(bitmap*, std::ostream&);
+    void initialize(bitmap*, std::ostream&, int numThreads = 1);
     bool HasNext();
     void ProcessNextBoundary();
+
+    // Walks the boundary from lattice edge #seed# back to #seed# into 
+    // #trace#. Given #unwalked#, the trace is speculative: each edge 
+    // walked is erased from #unwalked#, and the trace gives up, returning
+    // false, on a dead end or on reaching an edge that is less than #seed#
+    // or no longer in #unwalked#.
+    bool TraceBoundary(latticeEdge seed, Trace& trace, 
+        LatticeEdgeSet* unwalked = 0) const;
+
+    // Traces every remaining boundary into #traces#, in the order 
+    // ProcessNextBoundary would give them, sharing the work among 
+    // #numThreads# threads.
+    void TraceAll(TraceList& traces, int numThreads, std::ostream& out);
+
     std::string GetRelativeWord();
     std::string GetAbsoluteWord();
     location::Vector GetBoundary();
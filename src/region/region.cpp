@@ -36,25 +36,120 @@
 #include <map>
 #include <utility>
 #include <limits.h>
+#include <pthread.h>
+#include <algorithm>
+
+// Regions handed to a curvature worker at a time.
+#define REGION_CHUNK 16
+
+///////////////////////////////////////////////////////////////////////
+// State shared by every curvature worker of ParseBoundary. Each worker 
+// fills only the regions it has claimed, from their traces. The next 
+// region to claim, the tally, the first error and the output stream are 
+// guarded by lock.
+struct RegionShared
+{
+    bitmap& bmp;
+    SquareLatticeWalker::TraceList& traces;
+    std::vector<region*>& regions;
+    std::ostream& out;
+
+    pthread_mutex_t lock;
+    size_t next;
+    size_t completed;
+    bool failed;
+    catch_all_exception error;
+
+    RegionShared(bitmap& _bmp, SquareLatticeWalker::TraceList& _traces,
+        std::vector<region*>& _regions, std::ostream& _out) :
+        bmp(_bmp), traces(_traces), regions(_regions), out(_out), 
+        next(0), completed(0), failed(false), error((char*)"")
+    { pthread_mutex_init(&lock, NULL); }
+
+    ~RegionShared() { pthread_mutex_destroy(&lock); }
+};
+
+
+static void* RegionWorker(void* arg)
+{
+    RegionShared& sh = *static_cast<RegionShared*>(arg);
+    size_t n = sh.regions.size();
+
+    for (;;)
+    {
+        pthread_mutex_lock(&sh.lock);
+        size_t first = sh.next;
+        sh.next += REGION_CHUNK;
+        pthread_mutex_unlock(&sh.lock);
+
+        if (first >= n) break;
+        size_t last = std::min(first + REGION_CHUNK, n);
+
+        try {
+            for (size_t k = first; k < last; k++)
+                sh.regions[k]->ImportTrace(sh.bmp, sh.traces[k]);
+        }
+        catch (catch_all_exception e) {
+            pthread_mutex_lock(&sh.lock);
+            if (!sh.failed) sh.error = e;
+            sh.failed = true;
+            pthread_mutex_unlock(&sh.lock);
+        }
+
+        pthread_mutex_lock(&sh.lock);
+        sh.completed += last - first;
+        sh.out << sh.completed << " / " << n << "  \r";
+        sh.out.flush();
+        pthread_mutex_unlock(&sh.lock);
+    }
+
+    return 0;
+}
 
+
+/** Traces every boundary left in #walker#, finds each region's convex 
+	vertices and gathers them, in the order the walker gives boundaries 
+	one at a time. Tracing and curvature are each shared among 
+	#numThreads# threads; gathering is done in order afterwards, so the 
+	results do not depend on the thread count. */
 void ParseBoundary
     (location::Set& lin, location::Set& cvx, region::List& rvList, 
     bitmap* inputBmp, SquareLatticeWalker& walker, location::Vector& convex, 
     location::Vector& concave, location::Vector& straight, std::ostream& verbs,
-    bool storeWords, std::ofstream& logfile)  throw (catch_all_exception) {
+    bool storeWords, std::ofstream& logfile, int numThreads)  
+    throw (catch_all_exception) {
+
+    if (numThreads < 1) numThreads = 1;
+
+    SquareLatticeWalker::TraceList traces;
+    walker.TraceAll(traces, numThreads, verbs);
+
+    region::List found(traces.size());
+    std::vector<region*> regions;
+    for (region::List::iterator r = found.begin(); r != found.end(); r++)
+        regions.push_back(&*r);
+
+    RegionShared shared(*inputBmp, traces, regions, verbs);
+    std::vector<pthread_t> threads(numThreads);
+
+    // Thread 0 is the calling thread.
+    int started = 1;
+    for (; started < numThreads; started++) {
+        if (pthread_create(&threads[started], NULL, 
+            RegionWorker, &shared) != 0) {
+            std::cerr << "Could not start worker thread " 
+                << started << ".\n";
+            break;
+        }
+    }
+    RegionWorker(&shared);
+    for (int t = 1; t < started; t++) pthread_join(threads[t], NULL);
 
-	int originalSize = walker.size();
+    if (shared.failed) throw shared.error;
 
-	while (walker.size() > 0) 
+	for (size_t k = 0; k < regions.size(); k++) 
 	{
-        verbs << originalSize - walker.size() 
-              << " / " << originalSize << "  \r";
-        verbs.flush();
-
-		try {		    
-
-        region rv(walker);
-        rvList.push_back(rv);
+        region& rv = *regions[k];
 
         location::Vector::const_iterator start;
         location::Vector::const_iterator stop;
@@ -81,11 +176,9 @@ void ParseBoundary
             logfile << "Abs: " << rv.GetAbsoluteWord() << std::endl;
             logfile << "Rel: " << rv.GetRelativeWord() << std::endl;
         }				
-
-		}
-		// Upon error, print messages to stderr
-		catch (catch_all_exception e) {	throw e; }	
 	}
+
+    rvList.splice(rvList.end(), found);
 }
 		
 
@@ -104,6 +197,16 @@ region::region (SquareLatticeWalker& walker)
 }
 
 
+void region::ImportTrace (bitmap& bmp, SquareLatticeWalker::Trace& trace)
+{
+    boundary.swap(trace.boundary);
+    RelWord.swap(trace.relword);
+    AbsWord.swap(trace.absword);
+    initialized = (RelWord.length() != 0);
+    FindConvexVertices(bmp);
+}
+
+
 int region::SetMajorVertices
 		(bitmap& bmp, std::string& bword, char val) {
 
@@ -174,36 +277,43 @@ bool region::IsConvexVertex(bitmap& bmp, size_t index) {
 }
 
 
-bool region::IsConvexLocation(bitmap& bmp, location v) {
-	// Look for > 2 passible locations
-	// out of 4 neighbors.
-
-	// If this corner is not passible, its adjacent tiles should be.
-	if (!bmp.IsPassible(v.x+1,v.y+1)) {
-		if (bmp.IsPassible(v.x,v.y+1) &&
-			bmp.IsPassible(v.x+1,v.y))
-			return true;
-	}
+///////////////////////////////////////////////////////////////////////
+// Convexity and concavity of a vertex by the neighbourhood code of its 
+// cell (see PassabilityGrid::Neighbourhood). A vertex is convex when some
+// diagonal neighbour is impassible but both cells beside that diagonal 
+// are passible, and concave when the diagonal and both cells beside it 
+// are impassible.
+struct CornerTable
+{
+    bool convex[256];
+    bool concave[256];
+
+    CornerTable() {
+        typedef PassabilityGrid G;
+
+        // Each diagonal neighbour with the two cells beside it.
+        const int corner[4][3] = {
+            { G::SE, G::S, G::E }, { G::NE, G::N, G::E },
+            { G::SW, G::S, G::W }, { G::NW, G::N, G::W } };
+
+        for (int code = 0; code < 256; code ++) {
+            convex[code] = concave[code] = false;
+            for (int k = 0; k < 4; k ++) {
+                if (code & corner[k][0]) continue;
+                bool a = code & corner[k][1];
+                bool b = code & corner[k][2];
+                if (a && b)   convex[code]  = true;
+                if (!a && !b) concave[code] = true;
+            }
+        }
+    }
+};
 
-	if (!bmp.IsPassible(v.x+1,v.y-1)) {
-		if (bmp.IsPassible(v.x,v.y-1) &&
-			bmp.IsPassible(v.x+1,v.y))
-			return true;
-	}
+static const CornerTable cornerTable;
 
-	if (!bmp.IsPassible(v.x-1,v.y+1)) {
-		if (bmp.IsPassible(v.x,v.y+1) &&
-			bmp.IsPassible(v.x-1,v.y))
-			return true;
-	}
 
-	if (!bmp.IsPassible(v.x-1,v.y-1)) {
-		if (bmp.IsPassible(v.x,v.y-1) &&
-			bmp.IsPassible(v.x-1,v.y))
-			return true;
-	}
-
-	return false;
+bool region::IsConvexLocation(bitmap& bmp, location v) {
+	return cornerTable.convex[bmp.Grid().Neighbourhood(v.x,v.y)];
 }
 
 
@@ -216,32 +326,7 @@ bool region::IsConcaveVertex(bitmap& bmp, size_t index) {
 
 
 bool region::IsConcaveLocation(bitmap& bmp, location v) {
-	// If this corner is not passible, its adjacent tiles should _not_ be.
-	if (! bmp.IsPassible(v.x+1,v.y+1)) {
-		if (! bmp.IsPassible(v.x,v.y+1) &&
-			! bmp.IsPassible(v.x+1,v.y))
-			return true;
-	}
-
-	if (! bmp.IsPassible(v.x+1,v.y-1)) {
-		if (! bmp.IsPassible(v.x,v.y-1) &&
-			! bmp.IsPassible(v.x+1,v.y))
-			return true;
-	}
-
-	if (! bmp.IsPassible(v.x-1,v.y+1)) {
-		if (! bmp.IsPassible(v.x,v.y+1) &&
-			! bmp.IsPassible(v.x-1,v.y))
-			return true;
-	}
-
-	if (! bmp.IsPassible(v.x-1,v.y-1)) {
-		if (! bmp.IsPassible(v.x,v.y-1) &&
-			! bmp.IsPassible(v.x-1,v.y))
-			return true;
-	}
-
-	return false;
+	return cornerTable.concave[bmp.Grid().Neighbourhood(v.x,v.y)];
 }
 
 
@@ -124,6 +124,10 @@ class region : public region_boundary {
 	
 	region (SquareLatticeWalker& walker);
 	
+	// Takes #trace#'s boundary and words, leaving them empty, and finds
+	// the region's convex vertices.
+	void ImportTrace (bitmap& bmp, SquareLatticeWalker::Trace& trace);
+	
 	//@}
 
 	/////////////////////////////////////////////////////
@@ -164,7 +168,8 @@ void ParseBoundary
     (location::Set& lin, location::Set& cvx, region::List& rvList, 
     bitmap* inputBmp, SquareLatticeWalker& walker, location::Vector& convex, 
     location::Vector& concave, location::Vector& straight, std::ostream& verbs,
-    bool storeWords, std::ofstream& logfile)  throw (catch_all_exception);
+    bool storeWords, std::ofstream& logfile, int numThreads = 1)  
+    throw (catch_all_exception);
 
 
 #endif
@@ -47,8 +47,10 @@
 /* Word combinatorics and graph manipulators */
 #include "region/region.h"	                // Region detection support
 #include "polygon/polygon.hpp"              // Polygon object
-#include "polygon/AdjacencyMatrix.h"        // Matrix representation of graphs
+#include "polygon/AdjacencyGraph.h"         // Visibility graph of vertices
 #include "thorup/thorup.h"                  // Integer weight pathfinding
+#include "thorup/TiledPaths.h"              // Pathfinding by tiles
+#include "thorup/PathQueries.h"             // Batches of path queries
 
 /* Misc. utilities */
 #include "stopwatch/Stopwatch.h"            // For run time analysis
@@ -60,6 +62,39 @@
 
 extern onullstream null_ostream;            // For non-verbose (null) output
 
+
+////////////////////////////////////////////////////////////////////////
+// Answers the queries of queryFilename with P, writing the results next 
+// to it. False if the queries cannot be read or the results written.
+static bool AnswerPathQueries(PathMatrix& P, std::string queryFilename, 
+	int numThreads, bool verbose, bool appendToLog, std::ofstream& logfile)
+{
+	PathQueries Q;
+	if (!Q.Read(queryFilename)) return false;
+
+	std::string resultsFilename = queryFilename + ".out";
+	size_t csv = queryFilename.size() - 4;
+	if (queryFilename.size() >= 4 && queryFilename.substr(csv) == ".csv") 
+		resultsFilename = queryFilename.substr(0, csv) + ".out.csv";
+
+	if (verbose) std::cout << "Answering " << Q.size() << " path queries, "
+		<< Q.EndCount() << " distinct endpoints...\n";
+	if (appendToLog) logfile << TimeStamp() 
+		<< " :: Begin answering path queries.\n";
+
+	Q.Run(P, numThreads);
+
+	std::cout << Q.size() << " path queries in " << Q.Seconds() 
+		<< " seconds, " << Q.QueriesPerSecond() << " queries per second.\n";
+	if (appendToLog) logfile << TimeStamp() 
+		<< " :: End answering path queries :: " << Q.Seconds() << " (" 
+		<< Q.QueriesPerSecond() << " queries per second)" << std::endl;
+
+	if (verbose) std::cout << "Writing path query results to " 
+		<< resultsFilename << "\n";
+	return Q.Write(resultsFilename);
+}
+
 int main( int argc, char* argv[] ) {
 	
 	////////////////////////////////////////////////////////////////
@@ -93,6 +128,41 @@ int main( int argc, char* argv[] ) {
 	DistillerNames.insert(std::make_pair("footprint",       &Footprint));
 
 
+	////////////////////////////////////////////////////////////////
+	// Initialize command argument -> edge builder map
+	std::map<std::string, EdgeBuilder> EdgeBuilderNames;
+	EdgeBuilderNames.insert(std::make_pair("bresenham", BRESENHAM_EDGES));
+	EdgeBuilderNames.insert(std::make_pair("sweep",     SWEEP_EDGES));
+	EdgeBuilderNames.insert(std::make_pair("validate",  VALIDATE_EDGES));
+
+
+	////////////////////////////////////////////////////////////////
+	// Initialize command argument -> path matrix layout map
+	std::map<std::string, PathLayout> PathLayoutNames;
+	PathLayoutNames.insert(std::make_pair("wide",    WIDE_PATHS));
+	PathLayoutNames.insert(std::make_pair("compact", COMPACT_PATHS));
+	PathLayoutNames.insert(std::make_pair("next32",  NEXT32_PATHS));
+	PathLayoutNames.insert(std::make_pair("next16",  NEXT16_PATHS));
+	PathLayoutNames.insert(std::make_pair("symmetric", SYMMETRIC_PATHS));
+
+
+	////////////////////////////////////////////////////////////////
+	// Initialize command argument -> shortest paths engine map
+	std::map<std::string, SsspEngine> SsspEngineNames;
+	SsspEngineNames.insert(std::make_pair("thorup", THORUP_SSSP));
+	SsspEngineNames.insert(std::make_pair("binary", BINARY_HEAP_SSSP));
+	SsspEngineNames.insert(std::make_pair("4ary",   QUAD_HEAP_SSSP));
+	SsspEngineNames.insert(std::make_pair("radix",  RADIX_HEAP_SSSP));
+
+
+	////////////////////////////////////////////////////////////////
+	// Initialize command argument -> vertex order map
+	std::map<std::string, VertexOrder> VertexOrderNames;
+	VertexOrderNames.insert(std::make_pair("sorted",  SORTED_ORDER));
+	VertexOrderNames.insert(std::make_pair("hilbert", HILBERT_ORDER));
+	VertexOrderNames.insert(std::make_pair("zorder",  Z_ORDER));
+
+
 	////////////////////////////////////////////////////////////////
 	// Initialize various vertex counting variables
 	size_t boundaryTileCount    = 0;
@@ -119,6 +189,11 @@ int main( int argc, char* argv[] ) {
 	std::string logFilename;
 	std::string reportFilename;
 	std::string distillerName;
+	std::string edgeBuilderName;
+	std::string pathLayoutName;
+	std::string ssspEngineName;
+	std::string vertexOrderName;
+	std::string queryFilename;
 	
 	bool appendToLog = false;
 	bool verbose	 = false;
@@ -126,6 +201,13 @@ int main( int argc, char* argv[] ) {
 	bool saveLots	 = false;
 	bool saveReport  = false;
 	bool savePaths   = false;
+	bool streamPaths = false;
+	bool resumePaths = false;
+	int  checkpointSeconds = 60;
+	int  numThreads  = 1;
+	int  indexBlockSize = 0;
+	int  footprintRadius = FootprintRadius();
+	int  tileSize = 0;
 	
 	////////////////////////////////////////////////////////////////
 	// Fill command line input variables from argv
@@ -133,7 +215,28 @@ int main( int argc, char* argv[] ) {
 	if ( GetCommandLineInput (inFilename, outFilename, logFilename, 
 		reportFilename, distillerName, 
 		appendToLog, verbose, logToStdout, saveLots, saveReport, savePaths,
-		argc, argv) == false ) return 1;
+		streamPaths, resumePaths, checkpointSeconds,
+		numThreads, edgeBuilderName, pathLayoutName, ssspEngineName,
+		vertexOrderName, queryFilename, indexBlockSize, 
+		footprintRadius, tileSize, argc, argv) == false ) 
+		return 1;
+
+	if (EdgeBuilderNames.find(edgeBuilderName) == EdgeBuilderNames.end()) {
+		edgeBuilderName = "bresenham";
+	}
+
+	if (PathLayoutNames.find(pathLayoutName) == PathLayoutNames.end()) {
+		pathLayoutName = "wide";
+	}
+
+	if (SsspEngineNames.find(ssspEngineName) == SsspEngineNames.end()) {
+		ssspEngineName = "thorup";
+	}
+
+	if (VertexOrderNames.find(vertexOrderName) == VertexOrderNames.end()) {
+		vertexOrderName = "sorted";
+	}
+	VertexOrder vertexOrder = VertexOrderNames[vertexOrderName];
     
     //if (verbose) out = std::cout;
 
@@ -198,6 +301,7 @@ int main( int argc, char* argv[] ) {
 		if (DistillerNames.find(distillerName) == DistillerNames.end()) {
 			distillerName = "luminance";
 		}
+		SetFootprintRadius(footprintRadius);
 			
 		inputBmp  = OpenBitmap(inFilename, DistillerNames[distillerName]); 
 		outputBmp = OpenBitmap(nonMaskFilename, DistillerNames["luminance"]); 
@@ -225,8 +329,8 @@ int main( int argc, char* argv[] ) {
 	watch.Start();
 
     SquareLatticeWalker walker;
-    if (verbose) walker.initialize(inputBmp, std::cout);
-    else walker.initialize(inputBmp, null_ostream);
+    if (verbose) walker.initialize(inputBmp, std::cout, numThreads);
+    else walker.initialize(inputBmp, null_ostream, numThreads);
 
 	if (appendToLog) {
 		logfile << TimeStamp() << " :: End boundary detection :: "
@@ -259,11 +363,11 @@ int main( int argc, char* argv[] ) {
 	try { 
         if (verbose) {
             ParseBoundary(linV, cvxV, rvList, inputBmp, walker, cvx, ccv,
-                straight, std::cout, storeWords, logfile); 
+                straight, std::cout, storeWords, logfile, numThreads); 
         }
         else {
             ParseBoundary(linV, cvxV, rvList, inputBmp, walker, cvx, ccv,
-                straight, null_ostream, storeWords, logfile); 
+                straight, null_ostream, storeWords, logfile, numThreads); 
         }
 	} catch (catch_all_exception e) { std::cerr << e.what() << std::endl; }	
 		
@@ -300,117 +404,257 @@ int main( int argc, char* argv[] ) {
 //    return 0;
     
 
-	////////////////////////////////////////////////////////////////
-	// Construct adjacency matrix
-	
-	if (verbose) std::cout << "Determining edge weights...\n"; 
+	location::Vector mv;
 
-	if (appendToLog) {
-		logfile << TimeStamp() << " :: Begin adjacency matrix construction.\n";
-	}
+	// A path matrix saved by an earlier run answers queries without 
+	// being found again.
+	std::string pathMatrixFilename = outFilename + "path";
+	bool mapSavedPaths = !queryFilename.empty() && !savePaths && 
+		tileSize <= 0 && std::ifstream(pathMatrixFilename.c_str()).good();
 
-    // Initialize adjacency matrix
-	AdjacencyMatrix M;
-	if (verbose) M.initialize(cvxV,rvList,inputBmp,std::cout);
-	else M.initialize(cvxV,rvList,inputBmp,null_ostream);
 
-	m_0     = M.TotalEdgeCount();
-	n_0     = cvxV.size();
-	rho_0   = (float)m_0 / (float)n_0;
+	////////////////////////////////////////////////////////////////
+	// Find paths tile by tile, without a visibility graph or path
+	// matrix of the whole map.
 
-	if (appendToLog) {
-		logfile << TimeStamp() << " :: End adjacency matrix construction :: "
-			<< watch.Lap() << std::endl;		
+	if (tileSize > 0) {
+
+		// The vertices initializeConvex would keep.
+		for (location::Set::iterator it = cvxV.begin(); it != cvxV.end(); 
+			it ++) {
+			if (!region::IsConcaveLocation(*inputBmp, *it)) mv.push_back(*it);
+		}
+		n_0 = cvxV.size();
+		n_1 = mv.size();
+
+		PathLayout pathLayout = PathLayoutNames[pathLayoutName];
+		if (savePaths) std::cerr << "Tiled paths are not saved.\n";
+
+		if (verbose) std::cout 
+			<< "Generating shortest paths' lookup tables by "
+			<< tileSize << " pixel tiles...\n"; 
+		if (appendToLog) logfile << TimeStamp() 
+			<< " :: Begin making tiled shortest paths' lookup tables.\n";
+		watch.Start();
+
+		TiledPaths T;
+		EdgeBuilder edgeBuilder = EdgeBuilderNames[edgeBuilderName];
+		if (verbose) T.initialize(mv, inputBmp, tileSize, pathLayout, 
+			vertexOrder, edgeBuilder, SsspEngineNames[ssspEngineName], 
+			std::cout, numThreads);
+		else T.initialize(mv, inputBmp, tileSize, pathLayout, 
+			vertexOrder, edgeBuilder, SsspEngineNames[ssspEngineName], 
+			null_ostream, numThreads);
+
+		pathTime = watch.Lap();
+		if (verbose) std::cout << n_1 << " vertices, " << T.PortalCount() 
+			<< " portals, " << T.byte_size() << " bytes of tables.\n";
+		if (appendToLog) logfile << TimeStamp() 
+			<< " :: End making tiled shortest paths' lookup tables :: "
+			<< pathTime << " (" << T.byte_size() << " bytes)" << std::endl;
+
+		MarkAPath(T, inputBmp, outputBmp, mv, appendToLog && saveLots, 
+			logfile);
+		if (!queryFilename.empty()) 
+			std::cerr << "Path queries need a path matrix; not answered.\n";
 	}
-	
-	location::Vector mv;
 
 
 	////////////////////////////////////////////////////////////////
-    // Fill mv with the approximate minimum set of vertices required for
-    // pathfinding.
-
-    // Create a copy of M such that only convex vertices are used.
-    //M.RemoveConcaveVertices();
-    mv = M.GetConvexVertices();
-    AdjacencyMatrix A(M);    
-    assert(A.GetVertices() == mv);
-
-	m_1    = A.TotalEdgeCount();
-	n_1    = mv.size();
-	rho_1  = (float)m_1 / (float)n_1;
-	if (verbose) {
-	    std::cout << n_1 << " vertices and " << m_1 << " edges.\n";
-	    long t = m_1*n_1 + n_1*n_1;
-	    float l = log10f(t);
-	    std::cout << "Op count will be on the order of 10^" << l << "\n";
+	// Answer path queries with a saved path matrix.
+
+	else if (mapSavedPaths) {
+
+		PathMatrix P;
+		if (verbose) std::cout << "Mapping path matrix " 
+			<< pathMatrixFilename << "\n";
+		if (!P.MapFromDisk(pathMatrixFilename)) return 1;
+		P.SetBitmap(inputBmp);
+
+		mv  = P.GetIntToVer();
+		n_1 = mv.size();
+
+		if (indexBlockSize > 0) {
+			if (verbose) P.BuildVisibilityIndex(indexBlockSize, std::cout);
+			else P.BuildVisibilityIndex(indexBlockSize, null_ostream);
+		}
+
+		if (!AnswerPathQueries(P, queryFilename, numThreads, verbose, 
+			appendToLog, logfile)) return 1;
 	}
 
+	else {
+  
+            
+		////////////////////////////////////////////////////////////////
+		// Construct adjacency matrix
+            
+		if (verbose) std::cout << "Determining edge weights...\n"; 
+            
+		if (appendToLog) {
+			logfile << TimeStamp() 
+				<< " :: Begin adjacency matrix construction.\n";
+		}
 
-	////////////////////////////////////////////////////////////////
-	// Test runtime of pathfinding with polygon analysis
-    /*  choose a couple vertices and find the shortest  */
-    /*  path from one to the other */
+	    // Initialize adjacency matrix
+		AdjacencyGraph M;
+		EdgeBuilder edgeBuilder = EdgeBuilderNames[edgeBuilderName];
+		if (verbose) 
+			M.initialize(cvxV,rvList,inputBmp,std::cout,edgeBuilder,numThreads);
+		else 
+			M.initialize(cvxV,rvList,inputBmp,null_ostream,edgeBuilder,
+				numThreads);
+
+		m_0     = M.TotalEdgeCount();
+		n_0     = cvxV.size();
+		rho_0   = (float)m_0 / (float)n_0;
+
+		if (appendToLog) {
+			logfile << TimeStamp() << " :: End adjacency matrix construction :: "
+				<< watch.Lap() << std::endl;		
+		}
+	
 
-    // create a matrix with entries leading one through a path from
-    // the i'th entry to the j'th entry.
-    PathMatrix P(mv, inputBmp);
+		////////////////////////////////////////////////////////////////
+	    // Fill mv with the approximate minimum set of vertices required for
+	    // pathfinding.
+
+	    // Create a copy of M such that only convex vertices are used.
+	    mv = M.GetConvexVertices();
+	    AdjacencyGraph A;
+	    A.initializeConvex(M);
+	    assert(A.GetVertices() == mv);
+
+		m_1    = A.TotalEdgeCount();
+		n_1    = mv.size();
+		rho_1  = (float)m_1 / (float)n_1;
+		if (verbose) {
+		    std::cout << n_1 << " vertices and " << m_1 << " edges.\n";
+		    long t = m_1*n_1 + n_1*n_1;
+		    float l = log10f(t);
+		    std::cout << "Op count will be on the order of 10^" << l << "\n";
+		}
 
-	{
-        if (verbose) std::cout 
-            << "Control-C to quit. All output to this point is saved.\n"
-            << "Generating all-pairs shortest paths' lookup table...\n"; 
 
-        if (appendToLog) {
-            logfile << TimeStamp() 
-                << " :: Begin making all-pairs shortest paths' lookup table.\n";
-        }
-        watch.Start();
+		////////////////////////////////////////////////////////////////
+		// Test runtime of pathfinding with polygon analysis
+	    /*  choose a couple vertices and find the shortest  */
+	    /*  path from one to the other */
 
-        if (verbose) {
-            // Thorup's method  O(n^2 + nm)	
-            ThorupPaths(P,A,std::cout);
-        }
+	    // create a matrix with entries leading one through a path from
+	    // the i'th entry to the j'th entry.
+	    PathLayout pathLayout = PathLayoutNames[pathLayoutName];
+	    if (!PathMatrix::LayoutFits(pathLayout, mv.size())) {
+	        std::cerr << "Too many vertices for the " << pathLayoutName 
+	            << " path layout; using next32.\n";
+	        pathLayout = NEXT32_PATHS;
+	    }
+    
+	    // When streaming, rows go straight to the path matrix file, which is
+	    // mapped once it is complete.
+	    PathMatrix P;
+	    PathRowWriter rows;
+    
+	    // Only the paths within each connected component are found and 
+	    // stored; the matrix numbers its vertices component by component.
+	    std::vector<int> component;
+	    int componentCount = A.Components(component);
+	    if (verbose) std::cout << componentCount 
+	        << " connected components of vertices.\n";
+    
+	    if (streamPaths) {
+	        P.SetVertices(mv, inputBmp, pathLayout, component, vertexOrder);
+	        if (verbose) std::cout << "Writing path matrix to "
+	            << pathMatrixFilename << " as it is found\n";
+	        if (!rows.Open(pathMatrixFilename, P, resumePaths, 
+	            checkpointSeconds)) {
+	            std::cerr << "Keeping the path matrix in memory instead.\n";
+	            streamPaths = false;
+	        }
+	    }
+	    if (!streamPaths) 
+	        P.Set(mv, inputBmp, pathLayout, component, vertexOrder);
+
+		{
+	        if (verbose) std::cout 
+	            << "Control-C to quit. All output to this point is saved.\n"
+	            << "Generating all-pairs shortest paths' lookup table...\n"; 
+
+	        if (appendToLog) {
+	            logfile << TimeStamp() 
+	                << " :: Begin making all-pairs shortest paths' lookup table.\n";
+	        }
+	        watch.Start();
+
+	        if (verbose) {
+	            // Thorup's method  O(n^2 + nm), or Dijkstra's
+	            ThorupPaths(P,A,std::cout,numThreads,
+	                SsspEngineNames[ssspEngineName], streamPaths ? &rows : 0);
+	        }
         
-        else {
-            // Thorup's method  O(n^2 + nm)
-            ThorupPaths(P,A,null_ostream);
-        }
-
-        pathTime = watch.Lap();
+	        else {
+	            // Thorup's method  O(n^2 + nm), or Dijkstra's
+	            ThorupPaths(P,A,null_ostream,numThreads,
+	                SsspEngineNames[ssspEngineName], streamPaths ? &rows : 0);
+	        }
+
+	        if (streamPaths && 
+	            (!rows.Close() || !P.MapFromDisk(pathMatrixFilename))) {
+	            std::cerr << "Path matrix file i/o error.\n";
+	            return 1;
+	        }
+
+	        pathTime = watch.Lap();
         
-        if (appendToLog) {
-            logfile << TimeStamp() 
-                << " :: End making all-pairs shortest paths' lookup table :: "
-                << pathTime << std::endl;		
-        }
+	        if (appendToLog) {
+	            logfile << TimeStamp() 
+	                << " :: End making all-pairs shortest paths' lookup table :: "
+	                << pathTime << std::endl;		
+	        }
 
-        bool savePathLines = appendToLog && saveLots;
+	        if (indexBlockSize > 0) {
+	            if (verbose) std::cout << "Indexing visible vertices by "
+	                << indexBlockSize << " pixel blocks...\n";
+	            if (appendToLog) logfile << TimeStamp() 
+	                << " :: Begin visibility index.\n";
+	            watch.Start();
 
-        for (int i = 0; i < 1; i ++)
-            MarkAPath(P, inputBmp, outputBmp, mv, savePathLines, logfile);
+	            if (verbose) P.BuildVisibilityIndex(indexBlockSize, std::cout);
+	            else P.BuildVisibilityIndex(indexBlockSize, null_ostream);
 
-        if (savePaths) {
-    
-            std::string pathMatrixFilename = 
-                outFilename + "path";
+	            if (appendToLog) logfile << TimeStamp() 
+	                << " :: End visibility index :: " << watch.Lap() 
+	                << " (" << P.GetVisibilityIndex().byte_size() 
+	                << " bytes)" << std::endl;
+	        }
+
+	        bool savePathLines = appendToLog && saveLots;
+
+	        for (int i = 0; i < 1; i ++)
+	            MarkAPath(P, inputBmp, outputBmp, mv, savePathLines, logfile);
+
+	        if (!queryFilename.empty() && !AnswerPathQueries(P, queryFilename,
+	            numThreads, verbose, appendToLog, logfile)) return 1;
+
+	        if (savePaths && !streamPaths) {
             
-            if (verbose) std::cout << "Writing path matrix to "
-                << pathMatrixFilename << "\n";
+	            if (verbose) std::cout << "Writing path matrix to "
+	                << pathMatrixFilename << "\n";
   
             
-            std::ofstream pathMatrixFile
-                (pathMatrixFilename.c_str(), std::ios::binary);
+	            std::ofstream pathMatrixFile
+	                (pathMatrixFilename.c_str(), std::ios::binary);
             
-            if (!pathMatrixFile) {
-                std::cerr << "Path matrix file i/o error.";
-            }
+	            if (!pathMatrixFile) {
+	                std::cerr << "Path matrix file i/o error.";
+	            }
             
-            else {
-                P.SaveToDisk(pathMatrixFile);
-                pathMatrixFile.close();
-            }
-        }
+	            else {
+	                P.SaveToDisk(pathMatrixFile);
+	                pathMatrixFile.close();
+	            }
+	        }
+		}
 	}
 
 
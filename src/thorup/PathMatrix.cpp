@@ -35,15 +35,471 @@
 #include "PathMatrix.h"
 #include <fstream>
 #include <assert.h>
+#include <algorithm>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdio.h>
 #include "../thorup/thorup.h"
 #include "../thorup/Graph.h"
 
+
+////////////////////////////////////////////////////////////////////////////////
+// Path matrix files
+//
+// A file starts with a PathFileHeader. The vertex list, Height() locations, 
+// follows at locationsOffset, and the first vertex of each component, as 
+// a uint64_t, at componentsOffset. The entries follow at entriesOffset, 
+// row after row exactly as they are held in memory, so a mapped file can 
+// be queried in place. entriesOffset is a multiple of MATRIX_ALIGNMENT. 
+//
+// Files are read back only on machines of the byte order they were written
+// with. Version 1 files end their header before componentCount and hold a
+// single component, which their checksum does not cover. Files written 
+// before the header existed hold a size_t vertex count, the vertex list 
+// and the entries, and are still read by LoadFromDisk.
+
+const char     PATH_FILE_MAGIC[8]   = { 'T','A','S','P','A','P','M','\0' };
+const uint32_t PATH_FILE_VERSION    = 2;
+const uint32_t PATH_FILE_BYTE_ORDER = 0x01020304;
+
+struct PathFileHeader
+{
+    char     magic[8];          // PATH_FILE_MAGIC
+    uint32_t version;           // PATH_FILE_VERSION
+    uint32_t byteOrder;         // PATH_FILE_BYTE_ORDER, as the writer saw it
+    uint32_t layout;            // a PathLayout
+    uint32_t entrySize;         // bytes per entry
+    uint64_t vertexCount;
+    uint64_t locationsOffset;
+    uint64_t entriesOffset;
+    uint64_t entriesBytes;
+    uint64_t checksum;          // PathChecksum of the vertex list, the 
+                                // components, then the entries
+    uint64_t componentCount;
+    uint64_t componentsOffset;
+};
+
+// Bytes of a version 1 header.
+const size_t PATH_FILE_HEADER_V1_BYTES = offsetof(PathFileHeader, componentCount);
+
+
+// FNV-1a taken a 64 bit word at a time, with any tail taken a byte at a
+// time. h is the checksum of whatever came before data.
+const uint64_t PATH_CHECKSUM_BASIS = 0xcbf29ce484222325ULL;
+const uint64_t PATH_CHECKSUM_PRIME = 0x100000001b3ULL;
+
+static uint64_t PathChecksum(const char* data, size_t bytes, uint64_t h) {
+    size_t words = bytes / sizeof(uint64_t);
+    
+    for (size_t i = 0; i < words; i ++) {
+        uint64_t w;
+        memcpy(&w, data + i*sizeof(uint64_t), sizeof(w));
+        h = (h ^ w) * PATH_CHECKSUM_PRIME;
+    }
+    for (size_t i = words*sizeof(uint64_t); i < bytes; i ++)
+        h = (h ^ (unsigned char)data[i]) * PATH_CHECKSUM_PRIME;
+    
+    return h;
+}
+
+
+// The first vertex of each of c's components, as a file holds them.
+static std::vector<uint64_t> ComponentBegins(const PathComponents& c) {
+    std::vector<uint64_t> begins(c.Count());
+    for (int k = 0; k < c.Count(); k ++) begins[k] = c.Begin(k);
+    return begins;
+}
+
+
+// Fills every field of h but the checksum for a file of components in 
+// layout.
+static void FillPathFileHeader(PathFileHeader& h, PathLayout layout, 
+    const PathComponents& components)
+{
+    size_t n = components.Vertices();
+    
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PATH_FILE_MAGIC, sizeof(h.magic));
+    h.version         = PATH_FILE_VERSION;
+    h.byteOrder       = PATH_FILE_BYTE_ORDER;
+    h.layout          = layout;
+    h.entrySize       = PathMatrix::EntrySize(layout);
+    h.vertexCount     = n;
+    h.locationsOffset = sizeof(PathFileHeader);
+    h.componentCount  = components.Count();
+    h.componentsOffset= h.locationsOffset + n*sizeof(location);
+    h.entriesOffset   = h.componentsOffset + 
+                        h.componentCount*sizeof(uint64_t);
+    h.entriesOffset  += (MATRIX_ALIGNMENT - h.entriesOffset % MATRIX_ALIGNMENT)
+                        % MATRIX_ALIGNMENT;
+    h.entriesBytes    = PathMatrix::EntriesBytes(layout, components);
+}
+
+
+// True if h describes a file of fileSize bytes that this build can read.
+// Whether entriesBytes fits the components is left to 
+// SetPathFileComponents.
+static bool CheckPathFileHeader(const PathFileHeader& h, size_t fileSize) {
+    if (memcmp(h.magic, PATH_FILE_MAGIC, sizeof(h.magic)) != 0) {
+        std::cerr << "Not a path matrix file.\n";
+        return false;
+    }
+    if (h.version != PATH_FILE_VERSION && h.version != 1) {
+        std::cerr << "Path matrix file version " << h.version 
+            << " is not supported.\n";
+        return false;
+    }
+    if (h.byteOrder != PATH_FILE_BYTE_ORDER) {
+        std::cerr << "Path matrix file has the wrong byte order.\n";
+        return false;
+    }
+    
+    size_t headerBytes = (h.version == 1) ? 
+        PATH_FILE_HEADER_V1_BYTES : sizeof(PathFileHeader);
+    uint64_t componentsEnd = (h.version == 1) ? h.locationsOffset : 
+        h.componentsOffset + h.componentCount*sizeof(uint64_t);
+    
+    if (h.layout > SYMMETRIC_PATHS ||
+        h.entrySize != PathMatrix::EntrySize((PathLayout)h.layout) ||
+        h.vertexCount >= (uint64_t)INT_MAX ||
+        h.entriesOffset % MATRIX_ALIGNMENT != 0 ||
+        h.locationsOffset < headerBytes ||
+        h.locationsOffset + h.vertexCount*sizeof(location) > h.entriesOffset ||
+        (h.version != 1 && (h.componentCount > h.vertexCount ||
+            h.componentsOffset < headerBytes || 
+            componentsEnd > h.entriesOffset)) ||
+        h.entriesOffset + h.entriesBytes > fileSize) {
+        std::cerr << "Path matrix file header is damaged.\n";
+        return false;
+    }
+    return true;
+}
+
+
+// Sets components from the component list of a file with header h, 
+// begins, which a version 1 file does not have. False if the list is 
+// not one of h's vertices or the entries are not the size it gives.
+static bool SetPathFileComponents(const PathFileHeader& h, 
+    const std::vector<uint64_t>& begins, PathComponents& components)
+{
+    bool ok = begins.empty() || begins[0] == 0;
+    for (size_t k = 1; k < begins.size(); k ++) 
+        ok = ok && begins[k-1] < begins[k] && begins[k] < h.vertexCount;
+    
+    if (ok) {
+        std::vector<int> b(begins.begin(), begins.end());
+        components.Set(b, h.vertexCount);
+        ok = h.entriesBytes == 
+            PathMatrix::EntriesBytes((PathLayout)h.layout, components);
+    }
+    if (!ok) std::cerr << "Path matrix file header is damaged.\n";
+    return ok;
+}
+
+
+void PathComponents::Set(const std::vector<int>& begins, int n) {
+    start = begins;
+    if (start.empty() && n > 0) start.push_back(0);
+    start.push_back(n);
+    
+    int count = Count();
+    of.resize(n);
+    block.resize(count);
+    packed.resize(count);
+    
+    size_t entries = 0;
+    for (int c = 0; c < count; c ++) {
+        size_t size = Size(c);
+        block[c] = entries;
+        entries += size*size;
+        for (int a = start[c]; a < start[c+1]; a ++) of[a] = c;
+    }
+    blockEntries = entries;
+    
+    for (int c = 0; c < count; c ++) {
+        size_t size = Size(c);
+        packed[c] = entries;
+        entries += size*(size+1)/2;
+    }
+    packedEntries = entries;
+}
+
 void PathMatrix::ConstructMapping() { 
+    ver_to_int.clear();
     for (size_t i = 0; i < int_to_ver.size(); i ++)
         ver_to_int[int_to_ver[i]] = i;
 }
 
 
+// Distance of a along the Hilbert curve through a side by side square, 
+// side a power of two past a's coordinates.
+static uint64_t HilbertKey(location a, uint32_t side) {
+    uint32_t x = a.x;
+    uint32_t y = a.y;
+    uint64_t d = 0;
+    
+    for (uint32_t s = side/2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) ? 1 : 0;
+        uint32_t ry = (y & s) ? 1 : 0;
+        d += (uint64_t)s*s*((3*rx) ^ ry);
+        
+        // Turns the quadrant so the curve within it starts where the 
+        // last quadrant's ended.
+        if (ry == 0) {
+            if (rx == 1) {
+                x = side-1 - x;
+                y = side-1 - y;
+            }
+            std::swap(x,y);
+        }
+    }
+    return d;
+}
+
+
+// Morton code of a, y's bits interleaved above x's.
+static uint64_t ZOrderKey(location a) {
+    uint64_t d = 0;
+    for (int bit = 0; bit < 32; bit ++) {
+        d |= (uint64_t)(((uint32_t)a.x >> bit) & 1) << (2*bit);
+        d |= (uint64_t)(((uint32_t)a.y >> bit) & 1) << (2*bit+1);
+    }
+    return d;
+}
+
+
+// Numbers verts component by component, components in the order their 
+// first vertex is found and vertices in order within each.
+void PathMatrix::SetComponents(const std::vector<location>& verts, 
+    const std::vector<int>& component, VertexOrder order)
+{
+    int n = verts.size();
+    bool split = component.size() == verts.size();
+    
+    // The vertices in order, each paired with its curve key.
+    std::vector< std::pair<uint64_t,int> > ordered(n);
+    uint32_t side = 1;
+    for (int i = 0; i < n; i ++) 
+        while (side <= (uint32_t)std::max(verts[i].x, verts[i].y)) side *= 2;
+    
+    for (int i = 0; i < n; i ++) {
+        uint64_t key = i;
+        if (order == HILBERT_ORDER) key = HilbertKey(verts[i], side);
+        if (order == Z_ORDER)       key = ZOrderKey(verts[i]);
+        ordered[i] = std::make_pair(key, i);
+    }
+    if (order != SORTED_ORDER) std::sort(ordered.begin(), ordered.end());
+    
+    std::map<int,int> rank;
+    std::vector<int> count;
+    for (int k = 0; k < n; k ++) {
+        int c = split ? component[ordered[k].second] : 0;
+        std::map<int,int>::iterator it = rank.find(c);
+        if (it == rank.end()) {
+            it = rank.insert(std::make_pair(c, (int)count.size())).first;
+            count.push_back(0);
+        }
+        count[it->second] ++;
+    }
+    
+    std::vector<int> begins(count.size());
+    for (size_t c = 1; c < count.size(); c ++) 
+        begins[c] = begins[c-1] + count[c-1];
+    
+    std::vector<int> next(begins);
+    int_to_ver.resize(n);
+    for (int k = 0; k < n; k ++) {
+        int i = ordered[k].second;
+        int_to_ver[next[rank[split ? component[i] : 0]]++] = verts[i];
+    }
+    
+    components.Set(begins, n);
+}
+
+
+// Sizes the current layout's matrix to the components of the vertices 
+// and frees the others, along with any mapped file. Entries after the 
+// last are zeroed, as a PathRowWriter leaves them.
+void PathMatrix::Allocate() {
+    Unmap();
+    visibility.Clear();
+    
+    int n = int_to_ver.size();
+    int rows = n ? components.EntryCount(layout)/n : 0;
+    int w = (layout == WIDE_PATHS)    ? rows : 0;
+    int c = (layout == COMPACT_PATHS) ? rows : 0;
+    int h = (layout == NEXT32_PATHS)  ? rows : 0;
+    int q = (layout == NEXT16_PATHS)  ? rows : 0;
+    int s = (layout == SYMMETRIC_PATHS) ? rows : 0;
+    
+    wide.resize(w,n);
+    compact.resize(c,n);
+    next32.resize(h,n,NEXT32_NONE);
+    next16.resize(q,n,NEXT16_NONE);
+    symmetric.resize(s,n,NEXT32_NONE);
+    
+    if (rows == 0) return;
+    size_t used = (layout == SYMMETRIC_PATHS) ? 
+        components.Packed(n-1, n-1) + 1 : components.BlockEntries();
+    used *= EntrySize(layout);
+    memset(const_cast<char*>(EntryBytes()) + used, 0, byte_size() - used);
+}
+
+
+// The matrices are views of the mapping and are detached by Allocate; 
+// this only gives the pages back.
+void PathMatrix::Unmap() {
+    if (mapping) munmap(mapping, mappingSize);
+    mapping = 0;
+    mappingSize = 0;
+    mappedChecksum = 0;
+}
+
+
+size_t PathMatrix::EntrySize(PathLayout _layout) {
+    switch (_layout) {
+    case COMPACT_PATHS: return sizeof(CompactPathStep);
+    case NEXT32_PATHS:  return sizeof(uint32_t);
+    case NEXT16_PATHS:  return sizeof(uint16_t);
+    case SYMMETRIC_PATHS: return sizeof(uint32_t);
+    default:            return sizeof(PathStep);
+    }
+}
+
+
+size_t PathMatrix::EntriesBytes(PathLayout _layout, 
+    const PathComponents& _components) 
+{
+    return _components.EntryCount(_layout)*EntrySize(_layout);
+}
+
+
+size_t PathMatrix::byte_size() const {
+    return EntriesBytes(layout, components);
+}
+
+
+const char* PathMatrix::EntryBytes() const {
+    switch (layout) {
+    case COMPACT_PATHS: return compact.CharCast();
+    case NEXT32_PATHS:  return next32.CharCast();
+    case NEXT16_PATHS:  return next16.CharCast();
+    case SYMMETRIC_PATHS: return symmetric.CharCast();
+    default:            return wide.CharCast();
+    }
+}
+
+
+void PathMatrix::EncodeRow(PathLayout _layout, 
+    const PathComponents& _components, int a, 
+    const std::vector<PathStep>& row, 
+    std::vector<char>& entries, std::vector<char>& packed) 
+{
+    int c = _components.Of(a);
+    size_t first = _components.Begin(c);
+    size_t n = _components.Size(c);
+    const PathStep* r = &row[first];
+    
+    entries.resize(n*EntrySize(_layout));
+    packed.clear();
+    
+    switch (_layout) {
+    case COMPACT_PATHS: {
+        CompactPathStep* e = reinterpret_cast<CompactPathStep*>(&entries[0]);
+        for (size_t b = 0; b < n; b ++) e[b] = 
+            CompactPathStep(r[b].next, StoredLength32(r[b].pathLength));
+        break;
+    }
+    case NEXT16_PATHS: {
+        uint16_t* e = reinterpret_cast<uint16_t*>(&entries[0]);
+        for (size_t b = 0; b < n; b ++) e[b] = StoredNext16(r[b].next);
+        break;
+    }
+    case NEXT32_PATHS:
+    case SYMMETRIC_PATHS: {
+        uint32_t* e = reinterpret_cast<uint32_t*>(&entries[0]);
+        for (size_t b = 0; b < n; b ++) e[b] = StoredNext32(r[b].next);
+        if (_layout == NEXT32_PATHS) break;
+        
+        size_t i = a - first;
+        packed.resize((n-i)*sizeof(uint32_t));
+        uint32_t* l = reinterpret_cast<uint32_t*>(&packed[0]);
+        for (size_t b = i; b < n; b ++) 
+            l[b-i] = StoredLength32(r[b].pathLength);
+        break;
+    }
+    default: {
+        // Padding is zeroed so that equal rows are written alike.
+        memset(&entries[0], 0, entries.size());
+        PathStep* e = reinterpret_cast<PathStep*>(&entries[0]);
+        for (size_t b = 0; b < n; b ++) {
+            e[b].next = r[b].next;
+            e[b].pathLength = r[b].pathLength;
+        }
+    }
+    }
+}
+
+
+uint64_t PathMatrix::Checksum(bool withComponents) const {
+    uint64_t h = PATH_CHECKSUM_BASIS;
+    if (!int_to_ver.empty()) h = PathChecksum(
+        reinterpret_cast<const char*>(&int_to_ver[0]),
+        int_to_ver.size()*sizeof(location), h);
+    
+    std::vector<uint64_t> begins = ComponentBegins(components);
+    if (withComponents && !begins.empty()) h = PathChecksum(
+        reinterpret_cast<const char*>(&begins[0]), 
+        begins.size()*sizeof(uint64_t), h);
+    
+    return PathChecksum(EntryBytes(), byte_size(), h);
+}
+
+
+bool PathMatrix::VerifyChecksum() const {
+    return !mapping || Checksum(mappedVersion != 1) == mappedChecksum;
+}
+
+
+bool PathMatrix::operator==(PathMatrix& Q) {
+    if (layout != Q.layout || int_to_ver != Q.int_to_ver ||
+        !(components == Q.components)) return false;
+    switch (layout) {
+    case COMPACT_PATHS: return compact == Q.compact;
+    case NEXT32_PATHS:  return next32 == Q.next32;
+    case NEXT16_PATHS:  return next16 == Q.next16;
+    case SYMMETRIC_PATHS: return symmetric == Q.symmetric;
+    default:            return wide == Q.wide;
+    }
+}
+
+
+// Walks the next hops from a to b, adding up the same scaled edge weights 
+// that ThorupPaths searched with. Each hop's own entry is a shortest path
+// to b, so the sum is the length that was found for (a,b).
+undirectedLength PathMatrix::RecomputeLength(int a, int b) const {
+    if (a == b) return (Next(a,b) == a) ? 0 : UNDIRECTED_EDGE_MAX;
+
+    undirectedLength s = 2*int_to_ver.size()-1;
+    undirectedLength length = 0;
+    int at = a;
+    
+    for (size_t hops = 0; at != b; hops ++) {
+        int next = Next(at,b);
+        if (next == INT_MAX || next == at || hops == int_to_ver.size()) 
+            return UNDIRECTED_EDGE_MAX;
+        length += L2scaled(int_to_ver[at], int_to_ver[next], s);
+        at = next;
+    }
+    
+    return length;
+}
+
+
 bool MarkAPath
  ( PathMatrix& P, bitmap* inputBmp, bitmap* outputBmp, 
    location::Vector& mv, bool saveLines, std::ofstream& logStrm )
@@ -97,65 +553,555 @@ bool MarkAPath
 
 
 void PathMatrix::SaveToDisk(std::ofstream& outfile) {
-    #ifdef DEBUG
     if (!outfile) {
         std::cerr << "Bad ofstream passed to SaveToDisk.\n";
         return;
     }
-    #endif
     
-    // Write matrix dimensions.
-    size_t vertex_count  = Height();
-    outfile.write(reinterpret_cast<char*>(&vertex_count), sizeof(vertex_count));
+    size_t locationsBytes = int_to_ver.size()*sizeof(location);
+    
+    PathFileHeader h;
+    FillPathFileHeader(h, layout, components);
+    h.checksum        = Checksum();
+    
+    outfile.write(reinterpret_cast<const char*>(&h), sizeof(h));
     
     // Write conversion vector.
-    outfile.write(
-        reinterpret_cast<char*>(&int_to_ver[0]), 
-        int_to_ver.size()*sizeof(location));
+    if (locationsBytes) outfile.write(
+        reinterpret_cast<const char*>(&int_to_ver[0]), locationsBytes);
     
-    // Write vertex to integer map
-    // Unnecessary as this map can be reconstructed from int_to_ver.
-    //Write(outfile,ver_to_int); // from iterative_fstream.h
+    // Vertex to integer map is unnecessary as it can be reconstructed 
+    // from int_to_ver.
     
-    // Write the matrix itself.
-    char* chars = CharCast();
-    outfile.write(chars, byte_size());
-    delete chars;
+    std::vector<uint64_t> begins = ComponentBegins(components);
+    if (!begins.empty()) outfile.write(
+        reinterpret_cast<const char*>(&begins[0]), 
+        begins.size()*sizeof(uint64_t));
+    
+    // Pad up to the entries.
+    static const char padding[MATRIX_ALIGNMENT] = { 0 };
+    outfile.write(padding, h.entriesOffset - h.componentsOffset 
+        - begins.size()*sizeof(uint64_t));
+    
+    // Write the matrix itself, straight from its buffer.
+    outfile.write(EntryBytes(), byte_size());
 }
 		
 
-void PathMatrix::LoadFromDisk(std::ifstream& infile) {
-    #ifdef DEBUG
+bool PathMatrix::LoadFromDisk(std::ifstream& infile) {
     if (!infile) {
-        std::cerr << "Bad ofstream passed to SaveToDisk.\n";
-        return;
+        std::cerr << "Bad ifstream passed to LoadFromDisk.\n";
+        return false;
     }
-    #endif
 
-    // Read matrix dimensions
-    size_t vertex_count;    
-    infile.read(reinterpret_cast<char*>(&vertex_count), sizeof(vertex_count));
+    std::streampos start = infile.tellg();
+    infile.seekg(0, std::ios::end);
+    size_t fileSize = infile.tellg() - start;
+    infile.seekg(start);
     
-    // Resize matrix
-    resize(vertex_count,vertex_count);    
-    int_to_ver.resize(vertex_count);
+    PathFileHeader h;
+    memset(&h, 0, sizeof(h));
+    infile.read(reinterpret_cast<char*>(&h), sizeof(h));
+    
+    // A version 1 header is shorter, so a small file of one may end 
+    // within the header read.
+    bool legacy = (size_t)infile.gcount() < PATH_FILE_HEADER_V1_BYTES || 
+        memcmp(h.magic, PATH_FILE_MAGIC, sizeof(h.magic)) != 0;
+    infile.clear();
+
+    // Files without a header do not name their layout; it is told from 
+    // the number of bytes left for each entry after the vertex list.
+    if (legacy) {
+        infile.seekg(start);
+        
+        size_t vertex_count = 0;    
+        infile.read(reinterpret_cast<char*>(&vertex_count), 
+            sizeof(vertex_count));
+        
+        size_t entries   = vertex_count*vertex_count;
+        size_t remaining = fileSize - sizeof(vertex_count) 
+            - vertex_count*sizeof(location);
+        size_t entry_size = entries ? remaining / entries : sizeof(PathStep);
+        
+        if (!infile || vertex_count >= (size_t)INT_MAX || 
+            sizeof(vertex_count) + vertex_count*sizeof(location) > fileSize ||
+            entry_size*entries != remaining) entry_size = 0;
+        
+        memcpy(h.magic, PATH_FILE_MAGIC, sizeof(h.magic));
+        h.version         = 1;
+        h.byteOrder       = PATH_FILE_BYTE_ORDER;
+        h.entrySize       = entry_size;
+        h.vertexCount     = vertex_count;
+        h.locationsOffset = sizeof(vertex_count);
+        h.entriesOffset   = h.locationsOffset + vertex_count*sizeof(location);
+        h.entriesBytes    = remaining;
+
+        switch (entry_size) {
+        case sizeof(PathStep):        h.layout = WIDE_PATHS;    break;
+        case sizeof(CompactPathStep): h.layout = COMPACT_PATHS; break;
+        case sizeof(uint32_t):        h.layout = NEXT32_PATHS;  break;
+        case sizeof(uint16_t):        h.layout = NEXT16_PATHS;  break;
+        default:
+            std::cerr << "Path matrix file has an unknown entry size.\n";
+            return false;
+        }
+    }
+    
+    else if (!CheckPathFileHeader(h, fileSize)) return false;
     
     // Read conversion vector
-    infile.read(
+    layout = (PathLayout)h.layout;
+    int_to_ver.resize(h.vertexCount);
+    infile.seekg(start + (std::streamoff)h.locationsOffset);
+    if (h.vertexCount) infile.read(
         reinterpret_cast<char*>(&int_to_ver[0]), 
-        vertex_count*sizeof(location) );
+        h.vertexCount*sizeof(location) );
+
+    std::vector<uint64_t> begins(h.version == 1 ? 0 : h.componentCount);
+    infile.seekg(start + (std::streamoff)h.componentsOffset);
+    if (!begins.empty()) infile.read(
+        reinterpret_cast<char*>(&begins[0]), 
+        begins.size()*sizeof(uint64_t));
+    
+    if (!infile) {
+        std::cerr << "Path matrix file is truncated.\n";
+        return false;
+    }
+    if (!SetPathFileComponents(h, begins, components)) return false;
+
+    Allocate();
+    ConstructMapping();
+
+    // Read the matrix entries straight into its buffer
+    infile.seekg(start + (std::streamoff)h.entriesOffset);
+    infile.read(const_cast<char*>(EntryBytes()), byte_size());
+    
+    if (!infile) {
+        std::cerr << "Path matrix file is truncated.\n";
+        return false;
+    }
+    if (!legacy && Checksum(h.version != 1) != h.checksum) {
+        std::cerr << "Path matrix file fails its checksum.\n";
+        return false;
+    }
+    return true;
+}
+
+
+bool PathMatrix::MapFromDisk(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open " << filename << "\n";
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || 
+        (size_t)st.st_size < PATH_FILE_HEADER_V1_BYTES) {
+        std::cerr << filename << " is not a path matrix file.\n";
+        close(fd);
+        return false;
+    }
+    
+    // A private writable mapping shares the page cache with other readers
+    // and copies a page only if an entry in it is stored to.
+    size_t fileSize = st.st_size;
+    void* p = mmap(0, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    
+    if (p == MAP_FAILED) {
+        std::cerr << "Cannot map " << filename << "\n";
+        return false;
+    }
+    
+    // A version 1 header may be all of a small file, so the fields after
+    // it are read only from a copy.
+    const char* base = static_cast<const char*>(p);
+    PathFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(&h, base, std::min(fileSize, sizeof(h)));
+    
+    std::vector<uint64_t> begins;
+    bool ok = CheckPathFileHeader(h, fileSize);
+    if (ok && h.version != 1) {
+        const uint64_t* b = 
+            reinterpret_cast<const uint64_t*>(base + h.componentsOffset);
+        begins.assign(b, b + h.componentCount);
+    }
+    
+    PathComponents mappedComponents;
+    if (!ok || !SetPathFileComponents(h, begins, mappedComponents)) {
+        munmap(p, fileSize);
+        return false;
+    }
+    
+    // Queries jump about the file, so read ahead would mostly be wasted.
+    madvise(p, fileSize, MADV_RANDOM);
+    
+    const location* locs = 
+        reinterpret_cast<const location*>(base + h.locationsOffset);
+    int n = h.vertexCount;
+    
+    int_to_ver.clear();
+    components = PathComponents();
+    Allocate();
+    layout = (PathLayout)h.layout;
+    int_to_ver.assign(locs, locs + n);
+    components = mappedComponents;
+    ConstructMapping();
+    
+    int rows = n ? components.EntryCount(layout)/n : 0;
+    char* entries = static_cast<char*>(p) + h.entriesOffset;
+    switch (layout) {
+    case COMPACT_PATHS: 
+        compact.Attach(reinterpret_cast<CompactPathStep*>(entries), rows, n);
+        break;
+    case NEXT32_PATHS:  
+        next32.Attach(reinterpret_cast<uint32_t*>(entries), rows, n);
+        break;
+    case NEXT16_PATHS:  
+        next16.Attach(reinterpret_cast<uint16_t*>(entries), rows, n);
+        break;
+    case SYMMETRIC_PATHS:
+        symmetric.Attach(reinterpret_cast<uint32_t*>(entries), rows, n);
+        break;
+    default:            
+        wide.Attach(reinterpret_cast<PathStep*>(entries), rows, n);
+    }
+    
+    mapping = p;
+    mappingSize = fileSize;
+    mappedChecksum = h.checksum;
+    mappedVersion = h.version;
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PathRowWriter
+//
+// A checkpoint file holds one PathCheckpoint. The rows before rows are on 
+// disk, and checksum and carry are the writer's checksum of the vertex 
+// list and those rows. It is written to a temporary file that is then
+// renamed over the last, so it is never found half written.
+
+const char     PATH_CHECKPOINT_MAGIC[8] = { 'T','A','S','P','A','C','K','\0' };
+const uint32_t PATH_CHECKPOINT_VERSION  = 1;
+
+struct PathCheckpoint
+{
+    char     magic[8];          // PATH_CHECKPOINT_MAGIC
+    uint32_t version;           // PATH_CHECKPOINT_VERSION
+    uint32_t layout;
+    uint64_t vertexCount;
+    uint64_t graph;
+    uint64_t rows;
+    uint64_t checksum;
+    uint64_t carried;
+    char     carry[sizeof(uint64_t)];
+};
+
+
+PathRowWriter::PathRowWriter() : fd(-1), layout(WIDE_PATHS), n(0), 
+    entriesOffset(0), nextRow(0), window(1), closing(false),
+    failed(false), resume(false), graph(0), checkpointSeconds(60), 
+    lastCheckpoint(0), running(false), checksum(PATH_CHECKSUM_BASIS), 
+    carried(0)
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&rowPut, NULL);
+    pthread_cond_init(&rowWritten, NULL);
+}
+
+
+PathRowWriter::~PathRowWriter() {
+    if (running) Close();
+    pthread_cond_destroy(&rowWritten);
+    pthread_cond_destroy(&rowPut);
+    pthread_mutex_destroy(&lock);
+}
+
+
+bool PathRowWriter::Open(const std::string& _filename, const PathMatrix& P,
+    bool _resume, int _checkpointSeconds, size_t bufferBytes) 
+{
+    if (running) return false;
+    
+    filename   = _filename;
+    layout     = P.Layout();
+    int_to_ver = P.GetIntToVer();
+    components = P.GetComponents();
+    n          = int_to_ver.size();
+    resume     = _resume;
+    checkpointSeconds = _checkpointSeconds;
+    
+    // A checkpoint left over would describe rows about to be overwritten.
+    if (!resume) unlink(CheckpointFilename().c_str());
+    
+    // Read as well as written, for the symmetric layout's checksum. Rows 
+    // already written are kept when resuming.
+    fd = open(filename.c_str(), 
+        O_RDWR | O_CREAT | (resume ? 0 : O_TRUNC), 0644);
+    if (fd < 0) {
+        std::cerr << "Cannot open " << filename << "\n";
+        return false;
+    }
+    
+    PathFileHeader h;
+    FillPathFileHeader(h, layout, components);
+    entriesOffset = h.entriesOffset;
+    
+    // The header is written again, with its checksum, by Close.
+    std::vector<uint64_t> begins = ComponentBegins(components);
+    size_t locationsBytes  = n*sizeof(location);
+    size_t componentsBytes = begins.size()*sizeof(uint64_t);
+    std::vector<char> front(h.entriesOffset, 0);
+    memcpy(&front[0], &h, sizeof(h));
+    if (locationsBytes) memcpy(&front[h.locationsOffset], 
+        &int_to_ver[0], locationsBytes);
+    if (componentsBytes) memcpy(&front[h.componentsOffset], 
+        &begins[0], componentsBytes);
+    
+    // Both are whole numbers of 8 bytes, so nothing is carried.
+    checksum = PATH_CHECKSUM_BASIS;
+    carried  = 0;
+    if (locationsBytes) 
+        checksum = PathChecksum(&front[h.locationsOffset], locationsBytes, 
+            checksum);
+    if (componentsBytes) 
+        checksum = PathChecksum(&front[h.componentsOffset], componentsBytes, 
+            checksum);
+    
+    if (!WriteAt(&front[0], front.size(), 0) ||
+        ftruncate(fd, h.entriesOffset + h.entriesBytes) != 0) {
+        std::cerr << "Cannot write " << filename << "\n";
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    
+    size_t rowBytes = n*PathMatrix::EntrySize(layout);
+    if (layout == SYMMETRIC_PATHS) rowBytes += n*sizeof(uint32_t);
+    window   = (rowBytes && bufferBytes/rowBytes > 1) ? bufferBytes/rowBytes : 1;
+    nextRow  = 0;
+    closing  = false;
+    failed   = false;
+    
+    if (pthread_create(&thread, NULL, WriterMain, this) != 0) {
+        std::cerr << "Could not start path writer thread.\n";
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    running = true;
+    lastCheckpoint = time(0);
+    return true;
+}
+
+
+int PathRowWriter::Start(uint64_t _graph) {
+    graph = _graph;
+    if (!running || !resume) return 0;
+    
+    PathCheckpoint c;
+    memset(&c, 0, sizeof(c));
+    std::ifstream in(CheckpointFilename().c_str(), std::ios::binary);
+    in.read(reinterpret_cast<char*>(&c), sizeof(c));
+    
+    if (!in || memcmp(c.magic, PATH_CHECKPOINT_MAGIC, sizeof(c.magic)) != 0 ||
+        c.version != PATH_CHECKPOINT_VERSION || c.layout != (uint32_t)layout ||
+        c.vertexCount != (uint64_t)n || c.graph != graph || 
+        c.rows > (uint64_t)n || c.carried >= sizeof(carry)) {
+        std::cerr << "No checkpoint of this graph for " << filename 
+            << "; starting over.\n";
+        return 0;
+    }
+    
+    pthread_mutex_lock(&lock);
+    nextRow  = c.rows;
+    checksum = c.checksum;
+    carried  = c.carried;
+    memcpy(carry, c.carry, sizeof(carry));
+    pthread_mutex_unlock(&lock);
+    
+    return nextRow;
+}
+
+
+// Called by the writer thread with every row before #rows# written. The 
+// rows are flushed to disk before the checkpoint claims them.
+void PathRowWriter::Checkpoint(int rows) {
+    lastCheckpoint = time(0);
+    if (fdatasync(fd) != 0) return;
+    
+    PathCheckpoint c;
+    memset(&c, 0, sizeof(c));
+    memcpy(c.magic, PATH_CHECKPOINT_MAGIC, sizeof(c.magic));
+    c.version     = PATH_CHECKPOINT_VERSION;
+    c.layout      = layout;
+    c.vertexCount = n;
+    c.graph       = graph;
+    c.rows        = rows;
+    c.checksum    = checksum;
+    c.carried     = carried;
+    memcpy(c.carry, carry, sizeof(carry));
+    
+    std::string name = CheckpointFilename();
+    std::string temp = name + ".tmp";
+    std::ofstream out(temp.c_str(), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&c), sizeof(c));
+    out.close();
+    
+    if (!out || rename(temp.c_str(), name.c_str()) != 0) 
+        std::cerr << "Could not write checkpoint " << name << "\n";
+}
+
+
+void PathRowWriter::Put(int a, const std::vector<PathStep>& row) {
+    Row* r = new Row;
+    PathMatrix::EncodeRow(layout, components, a, row, r->entries, r->packed);
+    
+    pthread_mutex_lock(&lock);
+    while (a >= nextRow + window) pthread_cond_wait(&rowWritten, &lock);
+    pending[a] = r;
+    pthread_cond_signal(&rowPut);
+    pthread_mutex_unlock(&lock);
+}
+
+
+bool PathRowWriter::Close() {
+    if (!running) return false;
+    
+    pthread_mutex_lock(&lock);
+    closing = true;
+    pthread_cond_signal(&rowPut);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+    running = false;
+    
+    bool complete = !failed && nextRow == n;
+    for (std::map<int, Row*>::iterator i = pending.begin(); 
+        i != pending.end(); i ++) delete i->second;
+    pending.clear();
+    
+    // The symmetric layout's lengths and the padding after the last entry
+    // follow every row's entries, so they could only be checksummed once
+    // the rows were all written.
+    if (complete) {
+        uint64_t end = entriesOffset + 
+            PathMatrix::EntriesBytes(layout, components);
+        std::vector<char> chunk(1 << 20);
+        for (uint64_t at = entriesOffset + 
+            components.BlockEntries()*PathMatrix::EntrySize(layout); 
+            complete && at < end; ) {
+            size_t bytes = std::min((uint64_t)chunk.size(), end - at);
+            complete = pread(fd, &chunk[0], bytes, at) == (ssize_t)bytes;
+            AddToChecksum(&chunk[0], bytes);
+            at += bytes;
+        }
+    }
+    
+    if (complete) {
+        for (size_t i = 0; i < carried; i ++)
+            checksum = (checksum ^ (unsigned char)carry[i]) * 
+                PATH_CHECKSUM_PRIME;
+        carried = 0;
+        
+        PathFileHeader h;
+        FillPathFileHeader(h, layout, components);
+        h.checksum = checksum;
+        complete = WriteAt(reinterpret_cast<const char*>(&h), sizeof(h), 0);
+    }
+    
+    if (close(fd) != 0) complete = false;
+    fd = -1;
+    
+    if (complete) unlink(CheckpointFilename().c_str());
+    else std::cerr << "Path matrix file " << filename 
+        << " is incomplete.\n";
+    return complete;
+}
+
+
+void* PathRowWriter::WriterMain(void* arg) {
+    static_cast<PathRowWriter*>(arg)->WriteRows();
+    return 0;
+}
+
 
-    // Allocate memory for one row of matrix entries
-    char* chars = new char[row_size()];
+// Writes rows in order of source until Close is called and the next row 
+// was never put. A failed write drops every later row, so Put never waits
+// on a row that will not be written.
+void PathRowWriter::WriteRows() {
+    pthread_mutex_lock(&lock);
+    
+    for (;;) {
+        std::map<int, Row*>::iterator i = pending.find(nextRow);
+        if (i == pending.end()) {
+            if (closing) break;
+            pthread_cond_wait(&rowPut, &lock);
+            continue;
+        }
+        
+        Row* r = i->second;
+        pending.erase(i);
+        int a = nextRow;
+        pthread_mutex_unlock(&lock);
+        
+        if (!failed) {
+            int first = components.Begin(components.Of(a));
+            size_t entrySize = PathMatrix::EntrySize(layout);
+            failed = 
+                !WriteAt(&r->entries[0], r->entries.size(), entriesOffset + 
+                    (uint64_t)components.Entry(a, first)*entrySize) ||
+                (!r->packed.empty() && 
+                 !WriteAt(&r->packed[0], r->packed.size(), entriesOffset + 
+                    (uint64_t)components.Packed(a, a)*sizeof(uint32_t)));
+            AddToChecksum(&r->entries[0], r->entries.size());
+            
+            if (!failed && a+1 < n && 
+                time(0) - lastCheckpoint >= checkpointSeconds) 
+                Checkpoint(a+1);
+        }
+        delete r;
+        
+        pthread_mutex_lock(&lock);
+        nextRow ++;
+        pthread_cond_broadcast(&rowWritten);
+    }
     
-    // Grab a row at a time of matrix entires
-    for (size_t r = 0; r < vertex_count; r ++) {
-        infile.read(chars, row_size());
-        memcpy(&(*this)[r][0], chars, row_size());
+    pthread_mutex_unlock(&lock);
+}
+
+
+bool PathRowWriter::WriteAt(const char* data, size_t bytes, uint64_t offset) {
+    while (bytes > 0) {
+        ssize_t w = pwrite(fd, data, bytes, offset);
+        if (w <= 0) return false;
+        data   += w;
+        bytes  -= w;
+        offset += w;
     }
+    return true;
+}
+
 
-    // Clean up
-    delete chars;
+// As PathChecksum, but data may end part way through a word; the bytes 
+// left over are carried to the next call.
+void PathRowWriter::AddToChecksum(const char* data, size_t bytes) {
+    while (carried > 0 && carried < sizeof(carry) && bytes > 0) {
+        carry[carried++] = *data++;
+        bytes --;
+    }
+    if (carried == sizeof(carry)) {
+        checksum = PathChecksum(carry, sizeof(carry), checksum);
+        carried = 0;
+    }
+    
+    size_t whole = bytes - bytes % sizeof(uint64_t);
+    checksum = PathChecksum(data, whole, checksum);
+    
+    for (size_t i = whole; i < bytes; i ++) carry[carried++] = data[i];
 }
 		
 
@@ -165,9 +1111,12 @@ bool PathMatrix::IsEdge(location a, location b) {
 }
 
 
+// Every entry with a path has a next hop, so this need not find the 
+// path's length.
 bool PathMatrix::HasPath(location a, location b) {
-    if (PathLength(a,b) == UNDIRECTED_EDGE_MAX) return false;
-    return true;
+    if (ver_to_int.find(a) == ver_to_int.end()) return false;
+    if (ver_to_int.find(b) == ver_to_int.end()) return false;
+    return Next(ver_to_int[a], ver_to_int[b]) != INT_MAX;
 }
     
 
@@ -175,8 +1124,7 @@ location PathMatrix::NextTurn(location a, location b) {
     if (ver_to_int.find(a) == ver_to_int.end()) return NotALoc;
     if (ver_to_int.find(b) == ver_to_int.end()) return NotALoc;
 
-    int next = matrix<PathStep>::GetValue
-        (ver_to_int[a], ver_to_int[b]).next;
+    int next = Next(ver_to_int[a], ver_to_int[b]);
 
     if ((size_t)next > int_to_ver.size() || next < 0) return NotALoc;
     return int_to_ver[next];
@@ -186,8 +1134,7 @@ location PathMatrix::NextTurn(location a, location b) {
 undirectedLength PathMatrix::PathLength(location a, location b) {
     if (ver_to_int.find(a) != ver_to_int.end() && 
         ver_to_int.find(b) != ver_to_int.end())
-        return matrix<PathStep>::
-            GetValue(ver_to_int[a], ver_to_int[b]).pathLength;
+        return Length(ver_to_int[a], ver_to_int[b]);
     return UNDIRECTED_EDGE_MAX;
 }
 
@@ -195,8 +1142,7 @@ undirectedLength PathMatrix::PathLength(location a, location b) {
 bool PathMatrix::HasPath(location a) {
     if (ver_to_int.find(a) != ver_to_int.end()) {
         for (int i = 0; i < Height(); i ++)
-        if (matrix<PathStep>::GetValue(ver_to_int[a], i).pathLength 
-            != UNDIRECTED_EDGE_MAX) 
+        if (Next(ver_to_int[a], i) != INT_MAX) 
             return true;
     }
     
@@ -208,6 +1154,28 @@ bool PathMatrix::HasPath(location a) {
 }
 
 
+void PathMatrix::BuildVisibilityIndex(int blockSize, std::ostream& out) {
+    visibility.Build(bmp, int_to_ver, blockSize, out);
+}
+
+
+// Appends the indices of the vertices in line of sight from a, in vertex
+// order. Only the index's candidates for a's block are tested when there
+// is an index.
+void PathMatrix::VisibleVertices(const location& a, std::vector<int>& out) {
+    if (visibility.Covers(a)) {
+        for (const int* k = visibility.Begin(a); k != visibility.End(a); k ++)
+            if (bmp->HasLineOfSight(int_to_ver[*k], a))
+                out.push_back(*k);
+        return;
+    }
+    
+    for (size_t k = 0; k < int_to_ver.size(); k ++)
+        if (bmp->HasLineOfSight(int_to_ver[k], a))
+            out.push_back(k);
+}
+
+
 location::Pair PathMatrix::ShortestPathKey
 (const location& src, const location& dest, undirectedLength& length) 
 {	
@@ -235,66 +1203,74 @@ location::Pair PathMatrix::ShortestPathKey
 		return shortPathPair;
 	}
 	
-	// Find nearest vertices to src and to dest and store in lists
-	location::List srcVisible;
-	location::List destVisible;
+	// Find nearest vertices to src and to dest and store their indices
+	PathEnd srcEnd;
+	PathEnd destEnd;
+	FindPathEnd(src, srcEnd);
+	FindPathEnd(dest, destEnd);
 	
-	typedef location::List::iterator ListIter;
+	int i, j;
+	shortPathLength = JoinPathEnds(srcEnd, destEnd, i, j);
 	
-    // Find/store all vertices in line of sight from source location.
-    location::Pair source(src,src);
+    length = shortPathLength;
+	if (shortPathLength == UNDIRECTED_EDGE_MAX) return empty;
 
-	if (!HasPath(src,src)) {
-	    for (location::VectorIter i = int_to_ver.begin(); 
-            i != int_to_ver.end(); i ++)
+	shortPathPair.first  = int_to_ver[i];
+	shortPathPair.second = int_to_ver[j];
+    return shortPathPair;
+}
             
-            if (bmp->HasLineOfSight(*i, src))
-				srcVisible.push_back(*i);
-	}
+
+void PathMatrix::FindPathEnd(const location& a, PathEnd& end) {
+    end.verts.clear();
+    end.dist.clear();
+
+    // If a is a vertex, just use a. Otherwise find all vertices in its 
+    // line of sight.
+    std::map<location,int>::const_iterator v = ver_to_int.find(a);
+    if (v != ver_to_int.end() && Next(v->second, v->second) != INT_MAX) 
+        end.verts.push_back(v->second);
+    else VisibleVertices(a, end.verts);
 	
-    // If source is a vertex, just use source.
-	else srcVisible.push_back(src);
+    // The distance to each, found once rather than for every pair.
+    undirectedLength s = Scale();
+    end.dist.resize(end.verts.size());
+    for (size_t k = 0; k < end.verts.size(); k ++)
+        end.dist[k] = L2scaled(a, int_to_ver[end.verts[k]], s);
+}
 
-    // Find/store all vertices in line of sight from dest location.
-	if (!HasPath(dest,dest)) {
-	    for (location::VectorIter i = int_to_ver.begin(); 
-            i != int_to_ver.end(); i ++)
-            
-            if (bmp->HasLineOfSight(*i, dest))
-				destVisible.push_back(*i);
 
-	}
-    // If dest is a vertex, just use dest.
-	else destVisible.push_back(dest);
-
-    // Look for any vertices visible from both src and dest,
-    // Consider all ordered pairs of vertices visible from ( {src},{dest} )
-    // for longer paths.
-	for (ListIter i = srcVisible.begin();  i != srcVisible.end();  i ++)
-	for (ListIter j = destVisible.begin(); j != destVisible.end(); j ++) {
+undirectedLength PathMatrix::JoinPathEnds
+(const PathEnd& src, const PathEnd& dest, int& i, int& j) const
+{
+    undirectedLength shortPathLength = UNDIRECTED_EDGE_MAX;
+    i = j = INT_MAX;
+    
+    // Consider all ordered pairs of vertices visible from ( {src},{dest} ).
+	for (size_t a = 0; a < src.verts.size();  a ++)
+	for (size_t b = 0; b < dest.verts.size(); b ++) {
 	
-        // Get the total path length, using vertices (i,j) as initial
+        // Get the total path length, using vertices (a,b) as initial
         // and final vertices in the psudo-path.
 
-		undirectedLength thisPathLength = PathLength(*i,*j);
+		undirectedLength thisPathLength = 
+            Length(src.verts[a], dest.verts[b]);
 
         // Thorup's algorithm cannot handle 0 length edges, so 
         // this line corrects for PathMatrix diagonal entries.
-        if (*i == *j) thisPathLength = 0;
+        if (src.verts[a] == dest.verts[b]) thisPathLength = 0;
         
-		thisPathLength += L2scaled(src,*i,s) + L2scaled(dest,*j,s);
+		thisPathLength += src.dist[a] + dest.dist[b];
 		if (thisPathLength < 0) thisPathLength = UNDIRECTED_EDGE_MAX;
-		location::Pair thisPathPair(*i, *j);
 		
 		if (thisPathLength < shortPathLength) {
-			shortPathPair = thisPathPair;
+			i = src.verts[a];
+			j = dest.verts[b];
 			shortPathLength = thisPathLength;
 		}
 	}
     
-    length = shortPathLength;
-	if (shortPathLength == UNDIRECTED_EDGE_MAX) return empty;
-    return shortPathPair;
+	return shortPathLength;
 }
 		
 
@@ -385,9 +1361,8 @@ bool PathMatrix::AllPathsFound
 (location a)
 {
     int a_index = ver_to_int[a];
-    for (int b_index = 0; b_index < max_x()+1; b_index++)
-        if (matrix<PathStep>::
-            GetValue(a_index,b_index).pathLength == UNDIRECTED_EDGE_MAX)
+    for (int b_index = 0; b_index < Height(); b_index++)
+        if (Next(a_index,b_index) == INT_MAX)
             return false;
 
     return true;
@@ -36,9 +36,15 @@
 #include <vector>
 #include <map>
 #include <limits.h>
+#include <stdint.h>
+#include <stdexcept>
+#include <pthread.h>
+#include <time.h>
 #include <iostream>
+#include <string>
 #include "../bitmap/bitmap.h"
 #include "../bitmap/matrix.h"
+#include "../polygon/VisibilityIndex.h"
 #include "../location/location.hpp"
 #include "../thorup/Graph.h"
 
@@ -63,9 +69,142 @@ class PathStep
 };
 
 
+// Stored length of a CompactPathStep whose path is missing or too long for
+// 32 bits. The two are told apart by next.
+const uint32_t COMPACT_LENGTH_MAX = 0xFFFFFFFFu;
+
+// A PathStep packed into 8 bytes.
+class CompactPathStep
+{
+    public:
+    int32_t next;          // Next location on the way to this location
+    uint32_t pathLength;   // Length of the path, or COMPACT_LENGTH_MAX
+
+    CompactPathStep() : next(INT_MAX), pathLength(COMPACT_LENGTH_MAX) { }
+    CompactPathStep(int _next, uint32_t _pathLength) : next(_next),
+        pathLength(_pathLength) { }
+
+    bool operator==(const CompactPathStep& Q) const
+        { return next == Q.next && pathLength == Q.pathLength; }
+};
+
+
+// Stored next hop of a next-hop-only entry with no path.
+const uint32_t NEXT32_NONE = 0xFFFFFFFFu;
+const uint16_t NEXT16_NONE = 0xFFFFu;
+
+
+// How a PathMatrix stores its entries. The next-hop-only layouts keep no
+// lengths; PathLength walks the next hops and adds up the edge weights.
+enum PathLayout { 
+    WIDE_PATHS,     // PathStep, 16 bytes per entry
+    COMPACT_PATHS,  // CompactPathStep, 8 bytes per entry
+    NEXT32_PATHS,   // 32 bit next hop, 4 bytes per entry
+    NEXT16_PATHS,   // 16 bit next hop, 2 bytes per entry, under 65535 vertices
+    SYMMETRIC_PATHS // 32 bit next hop, and a 32 bit length stored once for
+                    // (i,j) and (j,i), about 6 bytes per entry
+};
+
+
+// How a PathMatrix numbers its vertices within each component. Vertices
+// near each other on the map get ids near each other along a curve, so 
+// the rows and search arrays a path touches are more often in cache.
+//   SORTED_ORDER  numbers them as location sorts, x-major.
+//   HILBERT_ORDER numbers them along a Hilbert curve over the map.
+//   Z_ORDER       numbers them in Morton order, interleaving x and y.
+enum VertexOrder { SORTED_ORDER, HILBERT_ORDER, Z_ORDER };
+
+
 const location NotALoc(INT_MAX,INT_MAX);
 
-class PathMatrix : public matrix<PathStep>
+
+// The vertices a path may leave a location by, or reach it by: the 
+// location itself if it is a vertex, otherwise each vertex in its line of
+// sight, along with its scaled distance from the location.
+struct PathEnd
+{
+    std::vector<int> verts;
+    std::vector<undirectedLength> dist;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/** How the vertices of a PathMatrix fall into the connected components of 
+	the graph its paths were found over, and where the entries of each 
+	component are kept.
+
+	A matrix numbers its vertices component by component, so component c
+	is vertices Begin(c) up to End(c). No path joins two components, so 
+	only the entries between two vertices of one component are stored. 
+	Each component's square block, row after row, follows the block of 
+	the component before it; a matrix of one component is a plain square.
+	The symmetric layout's packed lengths follow all of the blocks, each
+	component's upper triangle after the last's.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class PathComponents
+{
+    private:
+        std::vector<int> start;     // Begin of each component, then Vertices()
+        std::vector<int> of;        // Component of each vertex
+        std::vector<size_t> block;  // Entry of each component's first (a,a)
+        std::vector<size_t> packed; // Packed length of its first (a,a)
+        size_t blockEntries;        // Entries of all of the blocks
+        size_t packedEntries;       // Entries of the blocks and the lengths
+
+    public:
+        PathComponents() : start(1, 0), blockEntries(0), packedEntries(0) { }
+
+        /** Splits #n# vertices into components, the first vertex of each 
+            of which is in #begins#, increasing from 0. All #n# are one 
+            component if #begins# is empty. */
+        void Set(const std::vector<int>& begins, int n);
+
+        int Vertices() const { return start.back(); }
+        int Count() const { return (int)start.size()-1; }
+        int Of(int a) const { return of[a]; }
+        int Begin(int c) const { return start[c]; }
+        int End(int c) const { return start[c+1]; }
+        int Size(int c) const { return start[c+1] - start[c]; }
+
+        bool operator==(const PathComponents& Q) const 
+            { return start == Q.start; }
+
+        /** Entries of the blocks; the symmetric layout's lengths follow. */
+        size_t BlockEntries() const { return blockEntries; }
+
+        /** Entries of a #_layout# matrix of these components, padded to 
+            whole rows of Vertices() entries. */
+        size_t EntryCount(PathLayout _layout) const {
+            size_t n = Vertices();
+            size_t used = 
+                (_layout == SYMMETRIC_PATHS) ? packedEntries : blockEntries;
+            return n ? (used + n-1)/n*n : 0;
+        }
+
+        /** Index of entry (a,b), both of one component, counted from the 
+            first entry. Unchecked. */
+        size_t Entry(int a, int b) const {
+            int c = of[a];
+            size_t size = start[c+1] - start[c];
+            return block[c] + (size_t)(a-start[c])*size + (b-start[c]);
+        }
+
+        /** Index of the symmetric layout's length of (a,b), a <= b, both 
+            of one component, counted from the first entry. Unchecked. */
+        size_t Packed(int a, int b) const {
+            int c = of[a];
+            size_t size = start[c+1] - start[c];
+            size_t i = a - start[c];
+            return packed[c] + i*size - i*(i-1)/2 + (b-a);
+        }
+};
+
+
+class PathMatrix
 {
     private:
     
@@ -73,20 +212,179 @@ class PathMatrix : public matrix<PathStep>
     std::map<location, int> ver_to_int;    
     bitmap* bmp;
 
+    // Only the matrix of the current layout holds any entries, as rows of
+    // Height() entries placed as components says. Entries are addressed
+    // by their index from the first; any after the last are zero. After 
+    // MapFromDisk the matrix is a view of the mapped file.
+    PathComponents components;
+    PathLayout layout;
+    matrix<PathStep>        wide;
+    matrix<CompactPathStep> compact;
+    matrix<uint32_t>        next32;
+    matrix<uint16_t>        next16;
+
+    // SYMMETRIC_PATHS: next hops as in next32, then the lengths of (a,b),
+    // a <= b, packed row after row. Lengths too long for 32 bits are 
+    // COMPACT_LENGTH_MAX, as in compact.
+    matrix<uint32_t>        symmetric;
+
+    void*    mapping;
+    size_t   mappingSize;
+    uint64_t mappedChecksum;   // as recorded in the mapped file's header
+    uint32_t mappedVersion;    // of the mapped file's format
+
+    // Optional; lets ShortestPathKey skip vertices that cannot see a point.
+    VisibilityIndex visibility;
+
+    // Mappings cannot be shared between matrices, so neither can be copied.
+    PathMatrix(const PathMatrix&);
+    PathMatrix& operator=(const PathMatrix&);
+
     void ConstructMapping();
+    void SetComponents(const std::vector<location>& verts, 
+        const std::vector<int>& component, VertexOrder order);
+    void Allocate();
+    void Unmap();
+    undirectedLength RecomputeLength(int a, int b) const;
+    const char* EntryBytes() const;
+    uint64_t Checksum(bool withComponents = true) const;
+    void VisibleVertices(const location& a, std::vector<int>& out);
+
+    uint32_t& PackedLength(int a, int b) {
+        return (a <= b) ? symmetric[0][components.Packed(a,b)] 
+                        : symmetric[0][components.Packed(b,a)];
+    }
+
+    uint32_t PackedLength(int a, int b) const {
+        return (a <= b) ? symmetric[0][components.Packed(a,b)] 
+                        : symmetric[0][components.Packed(b,a)];
+    }
+
+    // Next hops and lengths as the smaller layouts store them.
+    static uint32_t StoredNext32(int _next) 
+        { return (_next == INT_MAX) ? NEXT32_NONE : _next; }
+    static uint16_t StoredNext16(int _next) 
+        { return (_next == INT_MAX) ? NEXT16_NONE : _next; }
+    static uint32_t StoredLength32(undirectedLength _pathLength) {
+        return (_pathLength < (undirectedLength)COMPACT_LENGTH_MAX) ?
+            (uint32_t)_pathLength : COMPACT_LENGTH_MAX;
+    }
+
+    // Stores entry (a,b) without a bounds check. In the symmetric layout
+    // only (a,b) with a <= b store their length, so the sources of a 
+    // ThorupPaths run still write only their own rows. Entries between 
+    // components have no place and are dropped.
+    void Store(int a, int b, int _next, undirectedLength _pathLength) {
+        if (components.Of(a) != components.Of(b)) return;
+        size_t e = components.Entry(a,b);
+        
+        switch (layout) {
+        case COMPACT_PATHS: 
+            compact[0][e] = 
+                CompactPathStep(_next, StoredLength32(_pathLength));
+            break;
+        case NEXT32_PATHS:
+            next32[0][e] = StoredNext32(_next);
+            break;
+        case NEXT16_PATHS:
+            next16[0][e] = StoredNext16(_next);
+            break;
+        case SYMMETRIC_PATHS:
+            symmetric[0][e] = StoredNext32(_next);
+            if (a <= b) PackedLength(a,b) = StoredLength32(_pathLength);
+            break;
+        default:
+            wide[0][e] = PathStep(_next, _pathLength);
+        }
+    }
 
     public:
     
-    PathMatrix() : bmp(0) { }
+    PathMatrix() : bmp(0), layout(WIDE_PATHS), mapping(0), mappingSize(0),
+        mappedChecksum(0), mappedVersion(0) { }
     
     PathMatrix( std::vector<location>& _int_to_ver, 
-                bitmap* _bmp) : 
-        matrix<PathStep>(_int_to_ver.size(),_int_to_ver.size()), 
-        int_to_ver(_int_to_ver), 
-        bmp(_bmp) { ConstructMapping(); }
+                bitmap* _bmp, PathLayout _layout = WIDE_PATHS) : 
+        bmp(_bmp), layout(_layout), mapping(0), mappingSize(0), 
+        mappedChecksum(0), mappedVersion(0) { 
+        SetComponents(_int_to_ver, std::vector<int>(), SORTED_ORDER);
+        Allocate(); 
+        ConstructMapping(); 
+    }
+
+    ~PathMatrix() { Unmap(); }
         
-    bool operator==(PathMatrix& Q) {
-        return matrix<PathStep>::operator==(Q) && int_to_ver == Q.int_to_ver;
+    bool operator==(PathMatrix& Q);
+
+    // True if a matrix of #n# vertices can be stored in #_layout#.
+    static bool LayoutFits(PathLayout _layout, size_t n) {
+        if (_layout == NEXT16_PATHS) return n < NEXT16_NONE;
+        return n < (size_t)INT_MAX;
+    }
+
+    // Bytes of one entry in #_layout#; for SYMMETRIC_PATHS, of one next
+    // hop or length.
+    static size_t EntrySize(PathLayout _layout);
+
+    // Bytes of entry storage for #_components# in #_layout#.
+    static size_t EntriesBytes(PathLayout _layout, 
+        const PathComponents& _components);
+
+    // The bitmap queries are answered against; LoadFromDisk and 
+    // MapFromDisk leave it as it was.
+    void SetBitmap(bitmap* _bmp) { bmp = _bmp; visibility.Clear(); }
+    bitmap* GetBitmap() const { return bmp; }
+
+    PathLayout Layout() const { return layout; }
+    bool IsMapped() const { return mapping != 0; }
+    int Height() const { return (int)int_to_ver.size(); }
+    const PathComponents& GetComponents() const { return components; }
+
+    // Bytes of entry storage, not counting the vertex list.
+    size_t byte_size() const;
+
+    // Next hop from vertex #a# towards vertex #b#, INT_MAX if none, as 
+    // it always is between components. Unchecked.
+    int Next(int a, int b) const {
+        if (components.Of(a) != components.Of(b)) return INT_MAX;
+        size_t e = components.Entry(a,b);
+        
+        switch (layout) {
+        case COMPACT_PATHS: return compact[0][e].next;
+        case NEXT32_PATHS: { 
+            uint32_t n = next32[0][e];
+            return (n == NEXT32_NONE) ? INT_MAX : (int)n;
+        }
+        case NEXT16_PATHS: {
+            uint16_t n = next16[0][e];
+            return (n == NEXT16_NONE) ? INT_MAX : (int)n;
+        }
+        case SYMMETRIC_PATHS: { 
+            uint32_t n = symmetric[0][e];
+            return (n == NEXT32_NONE) ? INT_MAX : (int)n;
+        }
+        default: return wide[0][e].next;
+        }
+    }
+
+    // Length of the path from vertex #a# to vertex #b#, 
+    // UNDIRECTED_EDGE_MAX if none. Unchecked.
+    undirectedLength Length(int a, int b) const {
+        if (components.Of(a) != components.Of(b)) 
+            return UNDIRECTED_EDGE_MAX;
+        if (layout == WIDE_PATHS) 
+            return wide[0][components.Entry(a,b)].pathLength;
+        if (layout == COMPACT_PATHS) {
+            const CompactPathStep& c = compact[0][components.Entry(a,b)];
+            if (c.pathLength != COMPACT_LENGTH_MAX) return c.pathLength;
+            if (c.next == INT_MAX) return UNDIRECTED_EDGE_MAX;
+        }
+        if (layout == SYMMETRIC_PATHS) {
+            uint32_t length = PackedLength(a,b);
+            if (length != COMPACT_LENGTH_MAX) return length;
+            if (Next(a,b) == INT_MAX) return UNDIRECTED_EDGE_MAX;
+        }
+        return RecomputeLength(a,b);
     }
 
     class EdgeIter {
@@ -125,26 +423,29 @@ class PathMatrix : public matrix<PathStep>
         
         void NextCol() { col ++; }
         void NextRow() { row ++; }
+        
+        int Col() const { return col; }
+        int Row() const { return row; }
         void NextEdge() { 
             if (HasNextRow()) NextRow(); 
             else { ResetRow(); NextCol(); } 
         }
         
         int GetNext() { 
-            return (*mat)[col][row].next; 
+            return mat->Next(col,row); 
         }
         
         undirectedLength GetPathLength() { 
-            return (*mat)[col][row].pathLength; 
+            return mat->Length(col,row); 
         }
         
-        PathStep& operator*  () { return (*mat)[col][row]; }
-        PathStep& operator-> () { return (*mat)[col][row]; }
+        PathStep operator* () 
+            { return PathStep(GetNext(), GetPathLength()); }
 
         location ColLoc()  const { return mat->int_to_ver[col];  }
         location RowLoc()  const { return mat->int_to_ver[row];  }
         location NextLoc() const 
-            { return mat->int_to_ver[(*mat)[col][row].next]; }
+            { return mat->int_to_ver[mat->Next(col,row)]; }
         
         std::vector<int> ExtractPath(Vertex<undirectedEdge>** pred) 
         {
@@ -161,20 +462,12 @@ class PathMatrix : public matrix<PathStep>
             return path;        
         }
         
-        // dist stores 
+        // Stores the first step of path (as returned by ExtractPath) and
+        // its total length, dist[row]. Only this column's entries are 
+        // written, so columns may be filled by different threads at once.
         void StorePath(std::vector<int>& path, undirectedLength* dist) {
-            if (path.size() == 1) {
-                (*mat)[col][row].next = row;
-                (*mat)[col][row].pathLength = dist[row];
-            }
-            
-            int dest = row;
-            
-            for (size_t i=1; i < path.size(); i ++) {
-                int src = path[i-1];
-                (*mat)[src][dest].next = path[i];
-                (*mat)[src][dest].pathLength = dist[dest] - dist[src];
-            }
+            if (path.empty()) return;
+            mat->Store(col, row, path[0], dist[row]);
         }
     };
 
@@ -190,10 +483,35 @@ class PathMatrix : public matrix<PathStep>
 	EdgeIter GetEdgeIterator(location _col, location _row) 
 		{ return EdgeIter(this,_col,_row); }	
 
+    // Makes this a matrix of the vertices of #_int_to_ver#, none of which
+    // has a path yet. Given #_component#, the connected component of each
+    // of them, they are renumbered component by component and only the 
+    // entries within a component are stored. Otherwise they are taken as
+    // a single component. Within each component they are numbered in 
+    // #_order#, or kept in their order for SORTED_ORDER; GetIntToVer 
+    // gives the numbering.
     void Set(   std::vector<location> _int_to_ver, 
-                bitmap* _bmp) {
-        resize(_int_to_ver.size(),_int_to_ver.size());
-        int_to_ver = _int_to_ver; 
+                bitmap* _bmp, PathLayout _layout = WIDE_PATHS,
+                const std::vector<int>& _component = std::vector<int>(),
+                VertexOrder _order = SORTED_ORDER) {
+        SetComponents(_int_to_ver, _component, _order);
+        layout = _layout;
+        Allocate();
+        ConstructMapping();
+        bmp = _bmp;
+    }
+    
+    // Like Set, but allocates no entries, for a matrix whose rows are 
+    // written by a PathRowWriter. Only the vertex list may be queried 
+    // until the written file is loaded or mapped.
+    void SetVertices(const std::vector<location>& _int_to_ver, 
+                bitmap* _bmp, PathLayout _layout = WIDE_PATHS,
+                const std::vector<int>& _component = std::vector<int>(),
+                VertexOrder _order = SORTED_ORDER) {
+        int_to_ver.clear();
+        layout = _layout;
+        Allocate();
+        SetComponents(_int_to_ver, _component, _order);
         ConstructMapping();
         bmp = _bmp;
     }
@@ -201,37 +519,55 @@ class PathMatrix : public matrix<PathStep>
     void SetValue 
     (location a, location b, location _next, undirectedLength _pathLength) 
     { 
-        matrix<PathStep>::SetValue(
-            ver_to_int[a], 
-            ver_to_int[b], 
-            PathStep(ver_to_int[_next],_pathLength));
+        SetValue(ver_to_int[a], ver_to_int[b], ver_to_int[_next], 
+            _pathLength);
+    }
+
+    void SetValue (int a, int b, int _next, undirectedLength _pathLength) 
+        throw (std::out_of_range) { 
+        if ((unsigned)a >= (unsigned)Height() || 
+            (unsigned)b >= (unsigned)Height())
+            throw std::out_of_range("PathMatrix");
+        Store(a, b, _next, _pathLength);
     }
 
-    void SetValue (int a, int b, int _next, undirectedLength _pathLength) { 
-        matrix<PathStep>::SetValue(a, b, PathStep(_next,_pathLength));
+    // Stores row #a#, Height() entries of which only those of #a#'s 
+    // component are read, without a bounds check. As with Store, only 
+    // row #a# is written.
+    void StoreRow(int a, const std::vector<PathStep>& row) {
+        int c = components.Of(a);
+        for (int b = components.Begin(c); b < components.End(c); b ++) 
+            Store(a, b, row[b].next, row[b].pathLength);
     }
 
+    // Row #a# of a #_layout# matrix of #_components#, as it is held in 
+    // memory and on disk: #entries# gets the row's entries in #a#'s 
+    // component and, in the symmetric layout, #packed# the lengths of 
+    // (a,b) for b >= a in it.
+    static void EncodeRow(PathLayout _layout, 
+        const PathComponents& _components, int a, 
+        const std::vector<PathStep>& row, 
+        std::vector<char>& entries, std::vector<char>& packed);
+
     void Display(std::ostream& out) {
         
-        for (int i = 0; i < matrix<PathStep>::max_x()+1; i ++) {
+        for (int i = 0; i < Height(); i ++) {
             
             out << "\n" << int_to_ver[i] << "\n"; 
             
-        for (int j = 0; j < matrix<PathStep>::max_y()+1; j ++)
+        for (int j = 0; j < Height(); j ++)
         
             out << "  " << int_to_ver[j] << " -> " 
-                << matrix<PathStep>::GetValue(i,j).next << " : " 
-                << matrix<PathStep>::GetValue(i,j).pathLength << "\n";
+                << Next(i,j) << " : " 
+                << Length(i,j) << "\n";
         
         }
     }
     
     PathStep GetValue (location a, location b) { 
-        #ifdef DEBUG
-        PathStep p = matrix<PathStep>::GetValue( ver_to_int[a], ver_to_int[b]);
-        return p;
-        #endif
-        return matrix<PathStep>::GetValue( ver_to_int[a], ver_to_int[b]);
+        int i = ver_to_int[a];
+        int j = ver_to_int[b];
+        return PathStep(Next(i,j), Length(i,j));
     }
 
     bool IsEdge(location a, location b);
@@ -242,6 +578,19 @@ class PathMatrix : public matrix<PathStep>
 
 	location::Pair ShortestPathKey
         (const location& src, const location& dest, undirectedLength& length);
+
+    // Fills #end# with the vertices a path may leave or reach #a# by. 
+    // Their lengths are scaled as the matrix's.
+    void FindPathEnd(const location& a, PathEnd& end);
+
+    // Length of the shortest path from #src# to #dest# through the matrix,
+    // UNDIRECTED_EDGE_MAX if none, and in #i# and #j# the vertices it 
+    // first and last passes.
+    undirectedLength JoinPathEnds
+        (const PathEnd& src, const PathEnd& dest, int& i, int& j) const;
+
+    // Scale of the matrix's lengths, per pixel.
+    undirectedLength Scale() const { return 2*int_to_ver.size()-1; }
 	location::Vector ShortestPath(const location& src, const location& dest);
     location::Vector GeodesicPath(const location& src, const location& dest);
 
@@ -266,11 +615,128 @@ class PathMatrix : public matrix<PathStep>
     }
     
     location IntToVer(int i) { return int_to_ver[i]; }
-    const std::vector<location>& GetIntToVer() { return int_to_ver; }
+    const std::vector<location>& GetIntToVer() const { return int_to_ver; }
     
+    // Indexes the vertices visible from each #blockSize# square block of
+    // the bitmap for ShortestPathKey. Dropped whenever the vertices change.
+    void BuildVisibilityIndex(int blockSize, std::ostream& out);
+    const VisibilityIndex& GetVisibilityIndex() const { return visibility; }
+
+    // See PathMatrix.cpp for the file format.
     void SaveToDisk(std::ofstream& outfile);
-    void LoadFromDisk(std::ifstream& infile);
+    bool LoadFromDisk(std::ifstream& infile);
+
+    // Maps a file written by SaveToDisk and queries its entries in place;
+    // only the vertex list is copied. Pages are shared with every other 
+    // process mapping the file until something is stored into them. The
+    // checksum is not checked; call VerifyChecksum for that.
+    bool MapFromDisk(const std::string& filename);
+    bool VerifyChecksum() const;
+
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/** Writes a path matrix file, as SaveToDisk would, a row at a time, so no
+	more than a few rows of the matrix are ever held in memory. 
+
+	Rows may be put in any order and from any number of threads. A 
+	background thread writes them in order of source, so the file and its
+	checksum are written front to back. Put blocks while its row is more 
+	than the buffer's worth of rows ahead of the next row to be written.
+
+	The file is complete only once Close returns true; it may then be 
+	read by LoadFromDisk or MapFromDisk.
+
+	Every so often the writer records in a checkpoint file, the path 
+	file's name followed by ".resume", how many rows are safely on disk 
+	and what graph they were found over. A writer opened to resume goes 
+	on from there if the graph is the same, so an interrupted run need 
+	not find those rows again.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class PathRowWriter
+{
+    private:
+        struct Row {
+            std::vector<char> entries;
+            std::vector<char> packed;
+        };
+
+        int fd;
+        std::string filename;
+        PathLayout layout;
+        int n;
+        uint64_t entriesOffset;
+        std::vector<location> int_to_ver;
+        PathComponents components;
+
+        std::map<int, Row*> pending;  // Rows put but not yet written
+        int nextRow;                  // Source of the next row to write
+        int window;                   // Rows Put may run ahead of nextRow
+        bool closing;
+        bool failed;
+
+        bool resume;                  // Whether Start may use a checkpoint
+        uint64_t graph;               // Identity of the graph rows are of
+        int checkpointSeconds;
+        time_t lastCheckpoint;
+
+        pthread_t thread;
+        pthread_mutex_t lock;
+        pthread_cond_t rowPut;
+        pthread_cond_t rowWritten;
+        bool running;
+
+        // Checksum of everything written so far, but for carried bytes 
+        // that do not yet fill a word.
+        uint64_t checksum;
+        char carry[sizeof(uint64_t)];
+        size_t carried;
+
+        PathRowWriter(const PathRowWriter&);
+        PathRowWriter& operator= (const PathRowWriter&);
+
+        static void* WriterMain(void* arg);
+        void WriteRows();
+        bool WriteAt(const char* data, size_t bytes, uint64_t offset);
+        void AddToChecksum(const char* data, size_t bytes);
+        std::string CheckpointFilename() const 
+            { return filename + ".resume"; }
+        void Checkpoint(int rows);
+
+    public:
+        PathRowWriter();
+        ~PathRowWriter();
+
+        /** Starts #_filename# for the vertices and layout of #P#, whose
+            entries need not be allocated. Unless #_resume#, the file and 
+            any checkpoint of it are started over. A checkpoint is taken 
+            every #_checkpointSeconds#. Rows of up to #bufferBytes# in all 
+            wait to be written at once, but at least one. */
+        bool Open(const std::string& _filename, const PathMatrix& P,
+            bool _resume = false, int _checkpointSeconds = 60, 
+            size_t bufferBytes = 64 << 20);
+
+        /** Names the graph the rows are found over, by a hash of its 
+            vertices and edges, and returns the first row to be put: the 
+            number of rows a checkpoint of the same graph found, if 
+            resuming, or else 0. Rows before it must not be put. Must be 
+            called before any row is put. */
+        int Start(uint64_t _graph);
+
+        bool IsOpen() const { return running; }
+
+        /** Queues row #a#, Height() entries of which only those of #a#'s
+            component are written. */
+        void Put(int a, const std::vector<PathStep>& row);
 
+        /** Writes what is queued, then the header. False, with the file
+            incomplete, if a row was never put or could not be written. */
+        bool Close();
 };
 
 
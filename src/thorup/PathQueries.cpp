@@ -0,0 +1,348 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "PathQueries.h"
+#include "../stopwatch/Stopwatch.h"
+
+
+///////////////////////////////////////////////////////////////////////
+// Run hands out work a chunk at a time from next, which lock guards. 
+// Ends are found in the first phase and queries answered in the second;
+// each chunk of queries puts its waypoints in its own vector, so they can
+// be joined in order afterwards.
+struct PathQueries::Shared
+{
+    PathQueries* queries;
+    PathMatrix* P;
+    
+    pthread_mutex_t lock;
+    size_t next;
+    size_t chunks;
+    size_t items;
+    size_t chunkSize;
+    bool answering;
+    
+    std::vector<location::Vector> chunkWaypoints;
+    
+    Shared() : queries(0), P(0), next(0), chunks(0), items(0), 
+        chunkSize(1), answering(false)
+        { pthread_mutex_init(&lock, NULL); }
+    
+    ~Shared() { pthread_mutex_destroy(&lock); }
+};
+
+
+// True if name ends in ".csv".
+static bool IsCsvName(const std::string& name) {
+    return name.size() >= 4 && name.compare(name.size()-4, 4, ".csv") == 0;
+}
+
+
+void PathQueries::Clear() {
+    srcEnd.clear();
+    destEnd.clear();
+    endLocs.clear();
+    endOf.clear();
+    ends.clear();
+    passable.clear();
+    lengths.clear();
+    first.clear();
+    waypoints.clear();
+    seconds = 0;
+}
+
+
+int PathQueries::EndOf(location a) {
+    std::map<location,int>::iterator i = endOf.find(a);
+    if (i != endOf.end()) return i->second;
+    
+    endOf[a] = endLocs.size();
+    endLocs.push_back(a);
+    return endLocs.size()-1;
+}
+
+
+void PathQueries::Add(location src, location dest) {
+    srcEnd.push_back(EndOf(src));
+    destEnd.push_back(EndOf(dest));
+}
+
+
+bool PathQueries::Read(const std::string& filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << filename << "\n";
+        return false;
+    }
+    
+    if (IsCsvName(filename)) {
+        std::string line;
+        for (int n = 1; std::getline(in, line); n ++) {
+            size_t k = line.find_first_not_of(" \t\r");
+            if (k == std::string::npos || line[k] == '#') continue;
+            
+            int sx, sy, dx, dy;
+            char extra;
+            if (sscanf(line.c_str(), " %d , %d , %d , %d %c", 
+                &sx, &sy, &dx, &dy, &extra) != 4) {
+                std::cerr << filename << ":" << n 
+                    << ": expected src_x,src_y,dest_x,dest_y\n";
+                return false;
+            }
+            Add(location(sx,sy), location(dx,dy));
+        }
+        return true;
+    }
+    
+    int32_t v[4];
+    while (in.read(reinterpret_cast<char*>(v), sizeof(v)))
+        Add(location(v[0],v[1]), location(v[2],v[3]));
+    
+    if (in.gcount() != 0) {
+        std::cerr << filename 
+            << " is not a whole number of 16 byte queries.\n";
+        return false;
+    }
+    return true;
+}
+
+
+// Ends begin up to end: each passable endpoint's visible vertices.
+void PathQueries::FindEnds(PathMatrix& P, size_t begin, size_t end) {
+    bitmap* bmp = P.GetBitmap();
+    for (size_t e = begin; e < end; e ++) {
+        passable[e] = bmp->IsPassible(endLocs[e]);
+        if (passable[e]) P.FindPathEnd(endLocs[e], ends[e]);
+    }
+}
+
+
+// Queries begin up to end, appending their waypoints to chunk. As in 
+// ShortestPathKey, a query's ends are joined directly when in sight of 
+// each other, else through the pair of their vertices that makes the 
+// shortest path.
+void PathQueries::Answer(PathMatrix& P, size_t begin, size_t end, 
+    location::Vector& chunk)
+{
+    bitmap* bmp = P.GetBitmap();
+    const std::vector<location>& verts = P.GetIntToVer();
+    undirectedLength s = P.Scale();
+    location::Vector path;
+    
+    for (size_t q = begin; q < end; q ++) {
+        int a = srcEnd[q];
+        int b = destEnd[q];
+        location src  = endLocs[a];
+        location dest = endLocs[b];
+        undirectedLength length = UNDIRECTED_EDGE_MAX;
+        path.clear();
+        
+        if (src == dest) {
+            length = 0;
+            path.push_back(src);
+        }
+        
+        else if (!passable[a] || !passable[b]) { }
+        
+        else if (bmp->HasLineOfSight(src, dest)) {
+            length = L2scaled(src, dest, s);
+            path.push_back(src);
+            path.push_back(dest);
+        }
+        
+        else {
+            int i, j;
+            length = P.JoinPathEnds(ends[a], ends[b], i, j);
+            
+            if (length != UNDIRECTED_EDGE_MAX) {
+                path.push_back(src);
+                for (int hops = 0; i != j && i != INT_MAX; hops ++) {
+                    if (hops == P.Height()) i = INT_MAX;
+                    else {
+                        if (verts[i] != path.back()) path.push_back(verts[i]);
+                        i = P.Next(i, j);
+                    }
+                }
+                
+                if (i == INT_MAX) {
+                    length = UNDIRECTED_EDGE_MAX;
+                    path.clear();
+                }
+                else {
+                    if (verts[j] != path.back()) path.push_back(verts[j]);
+                    if (dest != path.back()) path.push_back(dest);
+                }
+            }
+        }
+        
+        lengths[q] = (length == UNDIRECTED_EDGE_MAX) ? -1 : 
+            (double)length / s;
+        first[q+1] = path.size();
+        chunk.insert(chunk.end(), path.begin(), path.end());
+    }
+}
+
+
+void* PathQueries::WorkerMain(void* arg) {
+    Shared& sh = *static_cast<Shared*>(arg);
+    
+    for (;;) {
+        pthread_mutex_lock(&sh.lock);
+        size_t c = sh.next++;
+        pthread_mutex_unlock(&sh.lock);
+        
+        if (c >= sh.chunks) break;
+        
+        size_t begin = c*sh.chunkSize;
+        size_t end   = std::min(begin + sh.chunkSize, sh.items);
+        if (sh.answering) 
+            sh.queries->Answer(*sh.P, begin, end, sh.chunkWaypoints[c]);
+        else sh.queries->FindEnds(*sh.P, begin, end);
+    }
+    return 0;
+}
+
+
+void PathQueries::Run(PathMatrix& P, int numThreads) {
+    Stopwatch watch;
+    watch.Start();
+    
+    size_t n = size();
+    ends.assign(endLocs.size(), PathEnd());
+    passable.assign(endLocs.size(), false);
+    lengths.assign(n, -1);
+    first.assign(n+1, 0);
+    waypoints.clear();
+    
+    if (numThreads < 1) numThreads = 1;
+    std::vector<pthread_t> threads(numThreads);
+    
+    Shared sh;
+    sh.queries = this;
+    sh.P = &P;
+    
+    for (int phase = 0; phase < 2; phase ++) {
+        sh.answering = phase == 1;
+        sh.items     = sh.answering ? n : endLocs.size();
+        sh.chunkSize = sh.answering ? PATH_QUERY_CHUNK : 64;
+        sh.chunks    = (sh.items + sh.chunkSize-1)/sh.chunkSize;
+        sh.next      = 0;
+        if (sh.answering) sh.chunkWaypoints.assign(sh.chunks, 
+            location::Vector());
+        
+        // Thread 0 is the calling thread.
+        int started = 1;
+        for (; started < numThreads; started ++) {
+            if (pthread_create(&threads[started], NULL, WorkerMain, &sh) 
+                != 0) {
+                std::cerr << "Could not start query thread " 
+                    << started << ".\n";
+                break;
+            }
+        }
+        WorkerMain(&sh);
+        for (int t = 1; t < started; t ++) pthread_join(threads[t], NULL);
+    }
+    
+    // Each query's waypoint count becomes the index of its first.
+    for (size_t q = 0; q < n; q ++) first[q+1] += first[q];
+    waypoints.reserve(first[n]);
+    for (size_t c = 0; c < sh.chunks; c ++) {
+        waypoints.insert(waypoints.end(), 
+            sh.chunkWaypoints[c].begin(), sh.chunkWaypoints[c].end());
+        location::Vector().swap(sh.chunkWaypoints[c]);
+    }
+    
+    seconds = watch.Lap();
+}
+
+
+bool PathQueries::Write(const std::string& filename) const {
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    if (!out) {
+        std::cerr << "Cannot open " << filename << "\n";
+        return false;
+    }
+    
+    size_t n = size();
+    if (IsCsvName(filename)) {
+        out << std::fixed << std::setprecision(3);
+        for (size_t q = 0; q < n; q ++) {
+            if (lengths[q] < 0) out << "-1";
+            else out << lengths[q];
+            for (const location* w = Begin(q); w != End(q); w ++) 
+                out << "," << w->x << "," << w->y;
+            out << "\n";
+        }
+    }
+    
+    else {
+        PathResultsHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, PATH_RESULTS_MAGIC, sizeof(h.magic));
+        h.version       = PATH_RESULTS_VERSION;
+        h.queryCount    = n;
+        h.waypointCount = waypoints.size();
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        
+        if (n) out.write(reinterpret_cast<const char*>(&lengths[0]), 
+            n*sizeof(double));
+        
+        std::vector<uint64_t> offsets(first.begin(), first.end());
+        offsets.resize(n+1);
+        out.write(reinterpret_cast<const char*>(&offsets[0]), 
+            offsets.size()*sizeof(uint64_t));
+        
+        std::vector<int32_t> xy(2*waypoints.size());
+        for (size_t k = 0; k < waypoints.size(); k ++) {
+            xy[2*k]   = waypoints[k].x;
+            xy[2*k+1] = waypoints[k].y;
+        }
+        if (!xy.empty()) out.write(reinterpret_cast<const char*>(&xy[0]), 
+            xy.size()*sizeof(int32_t));
+    }
+    
+    out.close();
+    if (!out) {
+        std::cerr << "Cannot write " << filename << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,153 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHQUERIES_H
+#define PATHQUERIES_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include "thorup.h"
+#include "PathMatrix.h"
+#include "../location/location.hpp"
+
+// Queries a worker takes from the shared counter at a time.
+#define PATH_QUERY_CHUNK 1024
+
+const char     PATH_RESULTS_MAGIC[8] = { 'T','A','S','P','A','Q','R','\0' };
+const uint32_t PATH_RESULTS_VERSION  = 1;
+
+// Starts a binary results file written by PathQueries::Write.
+struct PathResultsHeader
+{
+    char     magic[8];          // PATH_RESULTS_MAGIC
+    uint32_t version;           // PATH_RESULTS_VERSION
+    uint32_t reserved;          // 0
+    uint64_t queryCount;
+    uint64_t waypointCount;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/** Many (source, destination) path queries, answered together against one
+	PathMatrix.
+
+	A query file is either CSV, named *.csv, of one "src_x,src_y,dest_x,
+	dest_y" line per query, or binary, of four int32_t per query in the 
+	same order. Blank lines and lines starting with '#' are skipped.
+
+	Each distinct endpoint's line of sight work, finding the vertices it 
+	sees and its distance to each, is done once however many queries 
+	share it. The queries are then split among threads. Lengths, in 
+	pixels, and waypoints go to flat arrays: the waypoints of query q are
+	Begin(q) up to End(q), the source first and the destination last. A
+	query with no path has length -1 and no waypoints.
+
+	Results are written as CSV, one "length,x,y,x,y,..." line per query,
+	to a file named *.csv. Otherwise they are written as a 
+	PathResultsHeader, the queries' lengths as doubles, the uint64_t 
+	index of each query's first waypoint and then of the end of the last,
+	and the waypoints as int32_t x, y pairs.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class PathQueries {
+
+	private:
+		// Per query, the index of its source and destination in ends.
+		std::vector<int> srcEnd;
+		std::vector<int> destEnd;
+
+		// Per distinct endpoint.
+		location::Vector endLocs;
+		std::map<location,int> endOf;
+		std::vector<PathEnd> ends;
+		std::vector<bool> passable;
+
+		// Results.
+		std::vector<double> lengths;
+		std::vector<size_t> first;
+		location::Vector waypoints;
+		double seconds;
+
+		// State shared by the workers of Run.
+		struct Shared;
+
+		int EndOf(location a);
+		void FindEnds(PathMatrix& P, size_t begin, size_t end);
+		void Answer(PathMatrix& P, size_t begin, size_t end, 
+			location::Vector& chunk);
+		static void* WorkerMain(void* arg);
+
+	public:
+		PathQueries() : seconds(0) { }
+
+		/** Forgets every query and result. */
+		void Clear();
+
+		/** Adds a query from #src# to #dest#. */
+		void Add(location src, location dest);
+
+		/** Adds the queries of #filename#. False, with a message, if it 
+			cannot be read. */
+		bool Read(const std::string& filename);
+
+		/** Answers every query with #P# on #numThreads# threads. */
+		void Run(PathMatrix& P, int numThreads = 1);
+
+		/** Writes the results to #filename#. */
+		bool Write(const std::string& filename) const;
+
+		size_t size() const { return srcEnd.size(); }
+
+		/** Number of distinct endpoints among the queries. */
+		size_t EndCount() const { return endLocs.size(); }
+
+		location Source(size_t q) const { return endLocs[srcEnd[q]]; }
+		location Destination(size_t q) const { return endLocs[destEnd[q]]; }
+
+		/** Length of query #q#'s path in pixels, -1 if it has none. */
+		double Length(size_t q) const { return lengths[q]; }
+
+		const location* Begin(size_t q) const 
+			{ return waypoints.empty() ? 0 : &waypoints[0] + first[q]; }
+		const location* End(size_t q) const 
+			{ return waypoints.empty() ? 0 : &waypoints[0] + first[q+1]; }
+
+		/** Seconds the last Run took. */
+		double Seconds() const { return seconds; }
+		double QueriesPerSecond() const 
+			{ return (seconds > 0) ? size() / seconds : 0; }
+};
+
+#endif
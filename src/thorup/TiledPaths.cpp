@@ -0,0 +1,455 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <queue>
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <stdlib.h>
+
+#include "TiledPaths.h"
+#include "../region/region.h"
+#include "../std_extensions/stream_objects.h"
+
+extern onullstream null_ostream;
+
+
+///////////////////////////////////////////////////////////////////////
+// Appends to pairs the portal pairs of count pixel pairs along a tile 
+// border, the i'th of which is a+i*step | b+i*step.
+static void BorderPortals(bitmap* bmp, location a, location b, 
+    location step, int count, 
+    std::vector< std::pair<location,location> >& pairs)
+{
+    int run = -1;       // First pair of the current run of open pairs
+    
+    for (int i = 0; i <= count; i ++) {
+        location u(a.x + i*step.x, a.y + i*step.y);
+        location v(b.x + i*step.x, b.y + i*step.y);
+        bool open = i < count && bmp->IsPassible(u) && bmp->IsPassible(v);
+        
+        if (open && run < 0) run = i;
+        if (open || run < 0) continue;
+        
+        int last = i-1;
+        if (last - run + 1 <= TILE_PORTAL_RUN) {
+            int mid = (run + last)/2;
+            pairs.push_back(std::make_pair(
+                location(a.x + mid*step.x, a.y + mid*step.y),
+                location(b.x + mid*step.x, b.y + mid*step.y)));
+        }
+        else {
+            pairs.push_back(std::make_pair(
+                location(a.x + run*step.x, a.y + run*step.y),
+                location(b.x + run*step.x, b.y + run*step.y)));
+            pairs.push_back(std::make_pair(
+                location(a.x + last*step.x, a.y + last*step.y),
+                location(b.x + last*step.x, b.y + last*step.y)));
+        }
+        run = -1;
+    }
+}
+
+
+void TiledPaths::Clear()
+{
+    for (size_t t = 0; t < tables.size(); t ++) 
+        if (tables[t]) delete tables[t];
+    
+    tables.clear();
+    tableScale.clear();
+    tilePortals.clear();
+    portals.clear();
+    portalTile.clear();
+    first.clear();
+    other.clear();
+    weight.clear();
+}
+
+
+int TiledPaths::TileOf(location a) const
+{
+    if (!bmp || a.x < 0 || a.y < 0 || 
+        a.x >= bmp->GetWidth() || a.y >= bmp->GetHeight()) return -1;
+    return (a.y/tileSize)*tileCols + a.x/tileSize;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// Numbers the portals along every tile border, each once however many 
+// pairs it is part of, and lists each pair as a crossing.
+void TiledPaths::FindPortals(std::vector< std::pair<int,int> >& crossings)
+{
+    int width  = bmp->GetWidth();
+    int height = bmp->GetHeight();
+    std::vector< std::pair<location,location> > pairs;
+    
+    // Borders between a tile and the one to its right.
+    for (int x = tileSize; x < width; x += tileSize)
+    for (int y = 0; y < height; y += tileSize)
+        BorderPortals(bmp, location(x-1,y), location(x,y), location(0,1),
+            std::min(tileSize, height-y), pairs);
+    
+    // Borders between a tile and the one below it.
+    for (int y = tileSize; y < height; y += tileSize)
+    for (int x = 0; x < width; x += tileSize)
+        BorderPortals(bmp, location(x,y-1), location(x,y), location(1,0),
+            std::min(tileSize, width-x), pairs);
+    
+    std::map<location,int> ids;
+    for (size_t i = 0; i < pairs.size(); i ++) {
+        int end[2];
+        location loc[2] = { pairs[i].first, pairs[i].second };
+        
+        for (int k = 0; k < 2; k ++) {
+            std::map<location,int>::iterator it = ids.find(loc[k]);
+            if (it != ids.end()) { end[k] = it->second; continue; }
+            
+            end[k] = (int)portals.size();
+            ids.insert(std::make_pair(loc[k], end[k]));
+            portals.push_back(loc[k]);
+            portalTile.push_back(TileOf(loc[k]));
+            tilePortals[TileOf(loc[k])].push_back(end[k]);
+        }
+        crossings.push_back(std::make_pair(end[0], end[1]));
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// Joins each portal to its pairs and, by their tile's table, to the other
+// portals of its tile.
+void TiledPaths::ConnectPortals
+(const std::vector< std::pair<int,int> >& crossings)
+{
+    int n = (int)portals.size();
+    std::vector< std::vector< std::pair<int,undirectedLength> > > adj(n);
+    
+    for (size_t i = 0; i < crossings.size(); i ++) {
+        int a = crossings[i].first;
+        int b = crossings[i].second;
+        undirectedLength w = L2scaled(portals[a], portals[b], scale);
+        adj[a].push_back(std::make_pair(b,w));
+        adj[b].push_back(std::make_pair(a,w));
+    }
+    
+    for (size_t t = 0; t < tilePortals.size(); t ++) {
+        const std::vector<int>& tp = tilePortals[t];
+        for (size_t i = 0; i < tp.size(); i ++)
+        for (size_t j = i+1; j < tp.size(); j ++) {
+            undirectedLength w = 
+                TileLength(t, portals[tp[i]], portals[tp[j]]);
+            if (w == UNDIRECTED_EDGE_MAX) continue;
+            adj[tp[i]].push_back(std::make_pair(tp[j],w));
+            adj[tp[j]].push_back(std::make_pair(tp[i],w));
+        }
+    }
+    
+    first.assign(n+1, 0);
+    for (int p = 0; p < n; p ++) first[p+1] = first[p] + adj[p].size();
+    
+    other.resize(first[n]);
+    weight.resize(first[n]);
+    for (int p = 0; p < n; p ++) 
+    for (size_t k = 0; k < adj[p].size(); k ++) {
+        other[first[p]+k]  = adj[p][k].first;
+        weight[first[p]+k] = adj[p][k].second;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// Length of the path from a to b in tile's table, in this object's scale.
+undirectedLength TiledPaths::TileLength(int tile, location a, location b)
+{
+    if (tile < 0 || !tables[tile]) return UNDIRECTED_EDGE_MAX;
+    
+    undirectedLength length = tables[tile]->PathLength(a,b);
+    if (length == UNDIRECTED_EDGE_MAX) return length;
+    
+    return (undirectedLength)
+        ((double)length * scale / tableScale[tile] + 0.5);
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// Appends the turns after a of the path from a to b in tile's table.
+bool TiledPaths::AppendTilePath
+(int tile, location a, location b, location::Vector& path)
+{
+    if (tile < 0 || !tables[tile]) return a == b;
+    PathMatrix& P = *tables[tile];
+    
+    for (int hops = 0; a != b; hops ++) {
+        if (hops == P.Height()) return false;
+        a = P.NextTurn(a,b);
+        if (a == NotALoc) return false;
+        path.push_back(a);
+    }
+    return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// Dijkstra's algorithm over the portal graph, from the portals of src's
+// tile, each as far as its table puts it from src, until no portal of 
+// dest's tile can lead to a shorter path. Fills via with the portals the 
+// shortest path passes, in order, none if it stays in one tile or is the
+// line from src to dest.
+undirectedLength TiledPaths::Search
+(location src, location dest, std::vector<int>& via)
+{
+    via.clear();
+    
+    int srcTile  = TileOf(src);
+    int destTile = TileOf(dest);
+    if (srcTile < 0 || destTile < 0) return UNDIRECTED_EDGE_MAX;
+    
+    undirectedLength best = UNDIRECTED_EDGE_MAX;
+    int bestPortal = -1;
+    if (srcTile == destTile) best = TileLength(srcTile, src, dest);
+    else if (bmp->HasLineOfSight(src, dest)) best = L2scaled(src, dest, scale);
+    
+    std::vector<undirectedLength> dist(portals.size(), UNDIRECTED_EDGE_MAX);
+    std::vector<int> pred(portals.size(), -1);
+    
+    typedef std::pair<undirectedLength,int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > 
+        heap;
+    
+    const std::vector<int>& starts = tilePortals[srcTile];
+    for (size_t i = 0; i < starts.size(); i ++) {
+        int p = starts[i];
+        dist[p] = TileLength(srcTile, src, portals[p]);
+        if (dist[p] != UNDIRECTED_EDGE_MAX) heap.push(Entry(dist[p],p));
+    }
+    
+    while (!heap.empty()) {
+        Entry e = heap.top();
+        heap.pop();
+        
+        int u = e.second;
+        if (e.first != dist[u]) continue;
+        if (e.first >= best) break;
+        
+        if (portalTile[u] == destTile) {
+            undirectedLength rest = TileLength(destTile, portals[u], dest);
+            if (rest != UNDIRECTED_EDGE_MAX && e.first + rest < best) {
+                best = e.first + rest;
+                bestPortal = u;
+            }
+        }
+        
+        for (int k = first[u]; k < first[u+1]; k ++) {
+            undirectedLength d = e.first + weight[k];
+            if (d < dist[other[k]]) {
+                dist[other[k]] = d;
+                pred[other[k]] = u;
+                heap.push(Entry(d,other[k]));
+            }
+        }
+    }
+    
+    for (int p = bestPortal; p >= 0; p = pred[p]) via.push_back(p);
+    std::reverse(via.begin(), via.end());
+    return best;
+}
+
+
+void TiledPaths::initialize(const location::Vector& mv, bitmap* bm, 
+    int _tileSize, PathLayout layout, VertexOrder order, 
+    EdgeBuilder builder, SsspEngine engine, std::ostream& out, 
+    int numThreads)
+{
+    Clear();
+    
+    bmp = bm;
+    tileSize = std::max(_tileSize, 1);
+    tileCols = (bmp->GetWidth()  + tileSize-1)/tileSize;
+    tileRows = (bmp->GetHeight() + tileSize-1)/tileSize;
+    
+    int tileCount = tileCols*tileRows;
+    tables.assign(tileCount, (PathMatrix*)0);
+    tableScale.assign(tileCount, 1);
+    tilePortals.assign(tileCount, std::vector<int>());
+    
+    std::vector< std::pair<int,int> > crossings;
+    FindPortals(crossings);
+    
+    std::vector<location::Set> tileVerts(tileCount);
+    for (size_t i = 0; i < mv.size(); i ++) 
+        if (TileOf(mv[i]) >= 0) tileVerts[TileOf(mv[i])].insert(mv[i]);
+    for (size_t p = 0; p < portals.size(); p ++) 
+        tileVerts[portalTile[p]].insert(portals[p]);
+    
+    size_t vertexCount = 0;
+    for (int t = 0; t < tileCount; t ++) vertexCount += tileVerts[t].size();
+    scale = (vertexCount > 0) ? 2*vertexCount-1 : 1;
+    
+    out << portals.size() << " portals among " << tileCount << " tiles.\n";
+    
+    ///////////////////////////////////////////////////////////////////
+    // Each tile's table covers its own vertices and portals only, so 
+    // only one is being built at a time.
+    
+    region::List noRegions;
+    for (int t = 0; t < tileCount; t ++) {
+        if (tileVerts[t].empty()) continue;
+        
+        AdjacencyGraph G;
+        G.initialize(tileVerts[t], noRegions, bmp, null_ostream, builder, 
+            numThreads);
+        
+        location::Vector verts = G.GetVertices();
+        PathLayout tileLayout = layout;
+        if (!PathMatrix::LayoutFits(tileLayout, verts.size())) 
+            tileLayout = NEXT32_PATHS;
+        
+        std::vector<int> component;
+        G.Components(component);
+        
+        tables[t] = new PathMatrix;
+        tables[t]->Set(verts, bmp, tileLayout, component, order);
+        tableScale[t] = 2*verts.size()-1;
+        ThorupPaths(*tables[t], G, null_ostream, numThreads, engine);
+        
+        out << t+1 << " / " << tileCount << " tiles processed.   \r";
+        out.flush();
+    }
+    out << "\n";
+    
+    ConnectPortals(crossings);
+}
+
+
+size_t TiledPaths::byte_size() const
+{
+    size_t bytes = first.size()*sizeof(int) + other.size()*sizeof(int) + 
+        weight.size()*sizeof(undirectedLength);
+    
+    for (size_t t = 0; t < tables.size(); t ++) 
+        if (tables[t]) bytes += tables[t]->byte_size();
+    return bytes;
+}
+
+
+bool TiledPaths::IsVertex(location a)
+{
+    int tile = TileOf(a);
+    return tile >= 0 && tables[tile] && tables[tile]->VerToInt(a) != INT_MAX;
+}
+
+
+undirectedLength TiledPaths::PathLength(location a, location b)
+{
+    location::Vector path = ShortestPath(a,b);
+    if (path.empty()) return UNDIRECTED_EDGE_MAX;
+    
+    undirectedLength length = 0;
+    for (size_t i = 1; i < path.size(); i ++) 
+        length += L2scaled(path[i-1], path[i], scale);
+    return length;
+}
+
+
+location::Vector TiledPaths::ShortestPath(location a, location b)
+{
+    location::Vector path;
+    std::vector<int> via;
+    
+    if (!IsVertex(a) || !IsVertex(b)) return path;
+    if (Search(a, b, via) == UNDIRECTED_EDGE_MAX) return path;
+    
+    // Consecutive portals of different tiles are a pair, one step apart.
+    path.push_back(a);
+    if (via.empty() && TileOf(a) != TileOf(b)) {
+        path.push_back(b);
+        return path;
+    }
+
+    location at = a;
+    int tile = TileOf(a);
+    
+    for (size_t i = 0; i < via.size(); i ++) {
+        location p = portals[via[i]];
+        if (portalTile[via[i]] != tile) path.push_back(p);
+        else if (!AppendTilePath(tile, at, p, path)) 
+            return location::Vector();
+        
+        at = p;
+        tile = portalTile[via[i]];
+    }
+    
+    if (!AppendTilePath(tile, at, b, path)) return location::Vector();
+    
+    // Portals are rarely where a shortest path would turn, so each turn 
+    // goes straight on to the last later turn in sight.
+    location::Vector turns(1, a);
+    for (size_t i = 0; i+1 < path.size(); ) {
+        size_t j = path.size()-1;
+        while (j > i+1 && !bmp->HasLineOfSight(path[i], path[j])) j --;
+        turns.push_back(path[j]);
+        i = j;
+    }
+    return turns;
+}
+
+
+bool MarkAPath
+ ( TiledPaths& T, bitmap* inputBmp, bitmap* outputBmp, 
+   location::Vector& mv, bool saveLines, std::ofstream& logStrm )
+{
+	size_t count = 0;
+	location::Vector path;
+	
+	if (mv.empty()) return false;
+	
+	for (;path.size() < 20-(count/50) && count < 1000; count ++) {
+		location src  = mv[rand()%mv.size()];
+		location dest = mv[rand()%mv.size()];
+		path = T.ShortestPath(src,dest);
+	}
+
+	rgba lineColor(64 + rand()%128, 64 + rand()%128, 64 + rand()%128);
+
+	for (size_t i = 1; i < path.size(); i ++) {
+		location::Vector line = inputBmp->GetLine(path[i-1],path[i]);
+		outputBmp->MarkVertices(line, lineColor);
+	}
+	
+	if (saveLines){
+		logStrm << "Path lines\n";
+		logStrm << LogLines(path, inputBmp->GetHeight());
+	}
+	
+	return path.size() > 1;
+}
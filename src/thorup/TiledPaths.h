@@ -0,0 +1,147 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEDPATHS_H
+#define TILEDPATHS_H
+
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include "thorup.h"
+#include "PathMatrix.h"
+#include "../bitmap/bitmap.h"
+#include "../location/location.hpp"
+
+// A run of passable pixel pairs along a tile border this long or shorter 
+// is crossed at its middle; a longer run at both of its ends.
+#define TILE_PORTAL_RUN 6
+
+////////////////////////////////////////////////////////////////////////////////
+/** Shortest paths among the vertices of a bitmap too large for one 
+	PathMatrix, kept as a PathMatrix per square tile of pixels and a graph 
+	over the tiles' portals.
+
+	Where the pixels on both sides of a tile border are passable, a pair 
+	of them, one in each tile, is a portal pair; the step between them is
+	the only way a path passes from one tile into the other. Each tile's 
+	table holds the paths among its vertices and portals, found by 
+	ThorupPaths over their visibility graph, which may look outside the 
+	tile. The portal graph joins each portal to the others of its tile by
+	the lengths in the tile's table, and to its pair by one pixel.
+
+	A query searches the portal graph from the portals of the source's 
+	tile to those of the destination's, so memory grows with the sum of 
+	the squares of the tiles' vertex counts rather than with the square of
+	the map's. Paths are as short as the portals allow, then straightened
+	wherever a later turn is in sight, so not always the shortest. Lengths
+	of every tile are brought to a single scale.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class TiledPaths {
+
+	private:
+		bitmap* bmp;
+		int tileSize;
+		int tileCols;
+		int tileRows;
+		undirectedLength scale;
+
+		// Per tile; a table is NULL if its tile has no vertices.
+		std::vector<PathMatrix*> tables;
+		std::vector<undirectedLength> tableScale;
+		std::vector< std::vector<int> > tilePortals;
+
+		// Per portal.
+		location::Vector portals;
+		std::vector<int> portalTile;
+
+		// Edges of portal p are first[p] up to first[p+1].
+		std::vector<int> first;
+		std::vector<int> other;
+		std::vector<undirectedLength> weight;
+
+		// Tables cannot be shared between two of these.
+		TiledPaths(const TiledPaths&);
+		TiledPaths& operator= (const TiledPaths&);
+
+		void Clear();
+		int TileOf(location a) const;
+		void FindPortals(std::vector< std::pair<int,int> >& crossings);
+		void ConnectPortals(const std::vector< std::pair<int,int> >& crossings);
+		undirectedLength TileLength(int tile, location a, location b);
+		bool AppendTilePath
+			(int tile, location a, location b, location::Vector& path);
+		undirectedLength Search
+			(location src, location dest, std::vector<int>& via);
+
+	public:
+		TiledPaths() : bmp(0), tileSize(0), tileCols(0), tileRows(0), 
+			scale(1) { }
+		~TiledPaths() { Clear(); }
+
+		/** Splits #bm# into #_tileSize# square tiles and finds the paths
+			among the vertices of #mv# and the portals in each of them, 
+			building each tile's visibility graph by #builder# and its 
+			table, in #layout# with its vertices in #order#, by #engine# 
+			on #numThreads# threads. */
+		void initialize(const location::Vector& mv, bitmap* bm, 
+			int _tileSize, PathLayout layout, VertexOrder order, 
+			EdgeBuilder builder, SsspEngine engine, std::ostream& out, 
+			int numThreads = 1);
+
+		int TileCount() const { return (int)tables.size(); }
+		int PortalCount() const { return (int)portals.size(); }
+
+		/** Bytes of the tables' entries and of the portal graph. */
+		size_t byte_size() const;
+
+		/** True if #a# is a vertex or portal of its tile. */
+		bool IsVertex(location a);
+
+		/** Length of ShortestPath(a,b), UNDIRECTED_EDGE_MAX if there is
+			none. */
+		undirectedLength PathLength(location a, location b);
+
+		/** The turns of the path from #a# to #b#, both vertices, starting
+			with #a# and ending with #b#; empty if there is none. */
+		location::Vector ShortestPath(location a, location b);
+};
+
+
+bool MarkAPath(TiledPaths& T, bitmap* inputBmp, 
+			bitmap* outputBmp, location::Vector& mv, bool saveLines, 
+			std::ofstream& logStrm);
+
+#endif
@@ -0,0 +1,134 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <new>
+#include <stdlib.h>
+
+// Bytes every allocation of an Arena is rounded up to, and aligned on.
+#define ARENA_ALIGNMENT 16
+
+////////////////////////////////////////////////////////////////////////////////
+/** Memory that is handed out in pieces and taken back all at once.
+
+	Allocate moves a pointer along a block, starting another block when the
+	current one is full. Nothing allocated is freed on its own; Reset makes
+	every block available again without returning any of them to the system.
+	If a run needed more than one block, Reset replaces them by a single 
+	block large enough for all of them, so a run of the same size after it 
+	allocates nothing.
+
+	Pieces are neither constructed nor destroyed, so only types that need 
+	neither should be kept in an Arena. An Arena is not safe to share 
+	between threads; give each thread its own.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class Arena {
+
+	private:
+		std::vector<char*>  blocks;
+		std::vector<size_t> sizes;
+		size_t current;             // Index of the block being handed out
+		size_t used;                // Bytes of it already handed out
+		size_t blockSize;           // Least size of a new block
+
+		// Copying would free the blocks twice.
+		Arena(const Arena&);
+		Arena& operator= (const Arena&);
+
+		void AddBlock(size_t bytes) {
+			void* p = 0;
+			if (posix_memalign(&p, ARENA_ALIGNMENT, bytes) != 0)
+				throw std::bad_alloc();
+			blocks.push_back(static_cast<char*>(p));
+			sizes.push_back(bytes);
+		}
+
+		void Release() {
+			for (size_t i = 0; i < blocks.size(); i ++) free(blocks[i]);
+			blocks.clear();
+			sizes.clear();
+		}
+
+	public:
+		Arena(size_t _blockSize = 1 << 16) : 
+			current(0), used(0), blockSize(_blockSize) { }
+
+		~Arena() { Release(); }
+
+		/** #bytes# bytes, aligned on ARENA_ALIGNMENT, that stay valid until 
+			the next Reset. */
+		void* Allocate(size_t bytes) {
+			bytes = (bytes + ARENA_ALIGNMENT-1) & ~(size_t)(ARENA_ALIGNMENT-1);
+
+			while (current < blocks.size() && used + bytes > sizes[current]) {
+				current ++;
+				used = 0;
+			}
+			if (current == blocks.size()) 
+				AddBlock(bytes > blockSize ? bytes : blockSize);
+
+			char* p = blocks[current] + used;
+			used += bytes;
+			return p;
+		}
+
+		/** #n# uninitialized T, which must need no constructor. */
+		template<typename T>
+		T* Allocate(size_t n) { return static_cast<T*>(Allocate(n*sizeof(T))); }
+
+		/** Takes back everything allocated since the last Reset. */
+		void Reset() {
+			if (current > 0) {
+				size_t total = Capacity();
+				Release();
+				AddBlock(total);
+			}
+			current = 0;
+			used = 0;
+		}
+
+		/** Bytes held, whether handed out or not. */
+		size_t Capacity() const {
+			size_t total = 0;
+			for (size_t i = 0; i < sizes.size(); i ++) total += sizes[i];
+			return total;
+		}
+};
+
+#endif
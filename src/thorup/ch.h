@@ -26,15 +26,10 @@ template<typename LengthType>
 class ComponentHierarchy {
 private:
 
-    bool *S;
     Vertex<undirectedEdge> *vertices;
     int numVerts;
     undirectedEdge *edges;
     int numEdges;
-    Vertex<undirectedEdge> *source;
-
-    LengthType *dist;          // array of distances indexed by vertex->id
-    Vertex<undirectedEdge> **pred; // array of predecessors indexed by vertex->id
 
     vector< chnode<LengthType>* > chnodes;
 
@@ -45,17 +40,17 @@ public:
     //   pEdges    - pointers to edges array
     //   pNumEdges - size of edges array
 
-    // ch(vertices,numVerts,edges,numEdges,pred,dist,S);
+    // ch(vertices,numVerts,edges,numEdges);
+    //
+    // The hierarchy only describes the graph. Searches over it are run by
+    // CHSearch, below.
 
-    ComponentHierarchy(bool* s,
-                       Vertex<undirectedEdge> *pVertices,
+    ComponentHierarchy(Vertex<undirectedEdge> *pVertices,
                        int pNumVerts,
                        undirectedEdge *pEdges,
-                       int pNumEdges,
-                       LengthType *d,
-                       Vertex<undirectedEdge> **p) :
-        S(s), vertices(pVertices), numVerts(pNumVerts), edges(pEdges),
-        numEdges(pNumEdges), dist(d), pred(p) { }
+                       int pNumEdges) :
+        vertices(pVertices), numVerts(pNumVerts), edges(pEdges),
+        numEdges(pNumEdges) { }
 
     ~ComponentHierarchy() {
         for (unsigned i=0; i<chnodes.size(); i++) 
@@ -234,19 +229,57 @@ public:
             return msb;
         }
 
-        void thorup(Vertex<undirectedEdge> *vertices,
-                    long numVerts,
-                    Vertex<undirectedEdge> *pSource
-                    ) {
-            source = pSource;
+        // number of chnodes in the hierarchy; chnode ids run 0...size()-1
+        int size() const { return chnodes.size(); }
 
-            //dist = new LengthType[numVerts+1];
-            //pred = new Vertex<undirectedEdge>*[numVerts+1];
+        chnode<LengthType>* node(int id) const { return chnodes[id]; }
+};
 
-            // copy to pointers that were passed in by reference
-            //d = dist;
 
-            // Initialization stuff
+// One search over a ComponentHierarchy. The hierarchy and the graph arrays
+// are only read, so any number of searches, each with its own S, dist, pred
+// and chnode state, may run over the same hierarchy at once.
+template<typename LengthType>
+class CHSearch {
+private:
+
+    const ComponentHierarchy<LengthType>& ch;
+
+    bool *S;
+    int numVerts;
+    Vertex<undirectedEdge> *source;
+
+    LengthType *dist;          // array of distances indexed by vertex->id
+    Vertex<undirectedEdge> **pred; // array of predecessors indexed by vertex->id
+
+    chstate<LengthType> *st;   // state of every chnode, indexed by chnode->id
+
+    Arena buckets;             // every chnode's buckets, freed by reset()
+    vector< chnode<LengthType>* > toVisit; // stack of the nodes each 
+                               // visitComponent has yet to visit
+
+public:
+    // parameters:
+    //   pCh       - a hierarchy on which compute() has been called
+    //   pNumVerts - size of the vertices array
+    //   s, d, p   - S, dist and pred; each numVerts+1 long
+
+    CHSearch(const ComponentHierarchy<LengthType>& pCh,
+             int pNumVerts,
+             bool* s,
+             LengthType *d,
+             Vertex<undirectedEdge> **p) :
+        ch(pCh), S(s), numVerts(pNumVerts), source(NULL), dist(d), pred(p),
+        st(new chstate<LengthType>[pCh.size()]) { }
+
+    ~CHSearch() {
+        delete [] st;
+    }
+
+        // Clears everything a previous call to thorup() left behind (S, 
+        // dist, pred and the buckets of every chnode), so the same
+        // hierarchy may be searched again from any other source.
+        void reset() {
             for (int i=0; i<=numVerts; i++) {
                 S[i] = false;
             }
@@ -256,10 +289,21 @@ public:
                 dist[i] = INT_MAX;
             }
 
-            int sz = chnodes.size();
+            int sz = ch.size();
             for (int i=0; i< sz; i++) {
-                chnodes[i]->init();
+                st[i].init();
             }
+            buckets.Reset();
+            toVisit.clear();
+        }
+
+        // Single source shortest paths from pSource over the hierarchy.
+        // Results are left in dist and pred.
+        void thorup(Vertex<undirectedEdge> *pSource) {
+            source = pSource;
+
+            // Initialization stuff
+            reset();
 
             dist[source->id] = 0;
             pred[source->id] = source;
@@ -277,7 +321,7 @@ public:
                 #endif
                 if (dist[source->id] + it->length < dist[it->other->id]) {
                     dist[it->other->id] = dist[source->id] + it->length;
-                    chnodes[it->other->id]->decreaseMinD(dist[it->other->id]);
+                    ch.node(it->other->id)->decreaseMinD(st,dist[it->other->id]);
                     pred[it->other->id] = source;
                     #ifdef DEBUG
 //                    printf("    Setting dist[%i] to %li\n",it->other->id,dist[it->other->id]);
@@ -286,7 +330,7 @@ public:
             }
             
             // find the root chnode for the source's component;
-            chnode<LengthType> *root = chnodes[source->id];
+            chnode<LengthType> *root = ch.node(source->id);
             while (root->parent != NULL)
                 root = root->parent;
             #ifdef DEBUG
@@ -294,7 +338,7 @@ public:
             #endif
 
 
-            root->isRoot = true;
+            st[root->id].isRoot = true;
             //S.insert(source);
 
             visitComponent(root);
@@ -312,14 +356,15 @@ public:
 //            printf("expand component: %i, level=%i, delta=%li\n",
 //                    n->id,n->level,n->delta);
 //            #endif
+            chstate<LengthType> &ns = st[n->id];
             // D.1
-            n->ix0 = n->getMinD() >> (n->level-1);
+            ns.ix0 = n->getMinD(st) >> (n->level-1);
             // D.2
-            n->ixinf = n->ix0 + n->delta;
+            ns.ixinf = ns.ix0 + n->delta;
             // D.3 
-            n->allocBuckets();
+            n->allocBuckets(st,buckets);
             // D.4.a
-            n->isRoot = false;
+            ns.isRoot = false;
 
  //           #if DEBUG
 //            printf("  ix0 <- %li, ixinf <- %li\n",n->ix0,n->ixinf);
@@ -338,18 +383,18 @@ public:
                 if ((*aChild)->vertex == source)
                     continue;
                 // D.4.b
-                (*aChild)->isRoot = true;
+                st[(*aChild)->id].isRoot = true;
                 // D.5.1
-                LengthType minD = (*aChild)->getMinD();
+                LengthType minD = (*aChild)->getMinD(st);
                 
                 LengthType index = (minD >> (n->level-1));
 //                #if DEBUG
 //                printf("    bucketing child %i with minD = %li and level = %i\n",
 //                        (*aChild)->id,minD,n->level);
 //                #endif
-                if (index > n->ixinf)
-                    index = n->ixinf;
-                n->addToBucket(index - n->ix0,*aChild);
+                if (index > ns.ixinf)
+                    index = ns.ixinf;
+                n->addToBucket(st,index - ns.ix0,*aChild);
             } 
         }
 
@@ -379,19 +424,10 @@ public:
 //                printf("  Edge (%i,%i)\n",v->id,w->id);
                 #endif
                 if ((dist[v->id] + it->length) < dist[w->id]) {
-                    // E.2.1
-                    //chnode<LengthType> *wh = chnodes[w->id]->unvisitedRoot();
-                    //chnode<LengthType> *wi = wh->visitedParent();
-                    //#ifdef DEBUG
-                    //printf("    Unvisited Root of %i is node #%i\n",w->id,wh->id);
-                    //printf("    Visited Parent of %i is node #%i\n",wh->id,wi->id);
-                    //#endif
-
-                    //LengthType oldVal = wh->getMinD() >> (wi->level - 1);
                     dist[w->id] = dist[v->id] + it->length;
 
                     // E.2.2
-                    chnodes[w->id]->decreaseMinD(dist[w->id]);
+                    ch.node(w->id)->decreaseMinD(st,dist[w->id]);
 
                     pred[w->id] = v;
 
@@ -415,6 +451,7 @@ public:
             #ifdef DEBUG
 //            printf("Visit component (id = %i)\n",n->id);
             #endif
+            chstate<LengthType> &ns = st[n->id];
             // F.1
             if (n->level == 0) {
                 // F.1.1
@@ -424,19 +461,18 @@ public:
                     #ifdef DEBUG
 //                    printf("  removing %i from parent %i\n",n->id,n->parent->id);
                     #endif
-                    n->parent->removeFromBuckets(n);
-                    //n->updateMinD(n->minD);
+                    n->parent->removeFromBuckets(st,n);
                 }
                 // F.1.3
                 return;
             }
 
             // F.2
-            if (n->isUnvisited()) {
+            if (n->isUnvisited(st)) {
                 // F.2.1
                 expandComponent(n);
                 // F.2.2
-                n->ix = n->ix0;
+                ns.ix = ns.ix0;
                 #ifdef DEBUG
 //                printf("  ix <- %li\n",n->ix);
                 #endif
@@ -447,13 +483,13 @@ public:
                 j = n->parent->level;
             else
                 j = sizeof(LengthType)*8;
-            LengthType base_shifted_ix = n->ix >> (j - n->level);
+            LengthType base_shifted_ix = ns.ix >> (j - n->level);
 
             #ifdef DEBUG
 //            printf("comp: %i, n->ix: %li shifted: %li, j: %i, level: %i \n",n->id,n->ix,base_shifted_ix,j,n->level);
             #endif
             // F.3
-            while (!n->isEmpty() && (n->ix >> (j - n->level)) == base_shifted_ix) {
+            while (!n->isEmpty(st) && (ns.ix >> (j - n->level)) == base_shifted_ix) {
 
                 //cannot assert this! maintained call-wise!!!
                 //assert ((n->ix >> (j - n->level)) == (n->minD >> (j-1)));
@@ -461,54 +497,51 @@ public:
                 // this loop is necessary because the calls to visitComponent
                 //  below could rebucket some children into this bucket.
                 //  F.3.1
-                while ( n->bucketCounts[n->ix - n->ix0] > 0) {
+                while ( ns.bucketCounts[ns.ix - ns.ix0] > 0) {
                     #ifdef DEBUG
 //                    printf("node: %i, examining index:%li ix: %li, ix0: %li\n",
 //                            n->id,n->ix-n->ix0,n->ix,n->ix0);
                     #endif
-                    unsigned ind = (unsigned)n->ix-n->ix0;
+                    unsigned ind = (unsigned)ns.ix-ns.ix0;
 //                    assert(ind < n->delta+1); // delta+1 = numBuckets
 
-                    chnode<LengthType>* it = n->bucketStart(ind);
+                    chnode<LengthType>* it = n->bucketStart(st,ind);
 
                     // F.3.1.1
-                    chnode<LengthType>** toVisit = new chnode<LengthType>*[n->bucketCounts[ind]];
-                    int count = n->bucketCounts[ind];
+                    // The nodes are pushed on toVisit and popped once 
+                    // visited; visits further down push theirs above 
+                    // them, so toVisit is indexed rather than pointed into.
+                    int count = ns.bucketCounts[ind];
+                    size_t base = toVisit.size();
                     int k=0;
                     for (k=0; k < count; k++) {
                         assert (it != NULL);
-                        toVisit[k] = it;
-                        it = it->next;
+                        toVisit.push_back(it);
+                        it = st[it->id].next;
                     }
                     for (k=0; k < count; k++) {
                         // F.3.1.2
-                        //LengthType x = n->minD >> j-1;
-                        visitComponent(toVisit[k]);
-                        //if (n->minD >> j-1 > x) {
-                       //     #ifdef DEBUG
-                        //    printf("----> should be done with visitComponent(%i): minD was %li and now is %li\n",n->id,x,n->minD>>j-1);
-                        //    #endif
-                        //}
+                        visitComponent(toVisit[base+k]);
                     }
-                    delete [] toVisit;
+                    toVisit.resize(base);
                 }
 
                 // F.3.2
-                n->ix++;
+                ns.ix++;
                 #ifdef DEBUG
 //                printf("*** node: %i, incrementing ix, new ix=%li\n",n->id,n->ix);
                 #endif
             }
             // F.4
-            if (!n->isEmpty() && n->parent != NULL) {
-                n->parent->removeFromBuckets(n);
-                int bucketNum = (n->ix >> (n->parent->level - n->level)) - n->parent->ix0;
-                n->parent->addToBucket(bucketNum,n);
+            if (!n->isEmpty(st) && n->parent != NULL) {
+                n->parent->removeFromBuckets(st,n);
+                int bucketNum = (ns.ix >> (n->parent->level - n->level)) - st[n->parent->id].ix0;
+                n->parent->addToBucket(st,bucketNum,n);
             }
             else if (n->parent != NULL) {
-                n->parent->removeFromBuckets(n);
+                n->parent->removeFromBuckets(st,n);
             }
-            if (n->parent == NULL && !n->isEmpty()) {
+            if (n->parent == NULL && !n->isEmpty(st)) {
 //                printf("uh oh\n");
                 assert(false);
             }
@@ -12,6 +12,7 @@
 #include<vector>
 #include "Graph.h"
 #include "unionfind.h"
+#include "arena.h"
 
 #ifndef CHNODE_H
 #define CHNODE_H
@@ -19,31 +20,21 @@
 using namespace std;
 
 template <typename LengthType>
-class chnode {
+class chnode;
 
-    typedef Vertex<undirectedEdge>* vertptr;
-    
+// The part of a chnode that Thorup's algorithm changes while it runs.
+// A search keeps one chstate for every chnode, indexed by chnode::id, so
+// the hierarchy itself is never written to and may be searched from
+// several sources at once.
+template <typename LengthType>
+class chstate {
     public:
-        chnode *parent; // pointer to this node's parent int he component hierarchy
-
-        Vertex<undirectedEdge> *vertex; // non-NULL when this node represents a single vertex (is a leaf)
-
-        int id; // this chnode's unique identification number
-
-        LengthType delta; // sum of all of the MST edges divided by 2^msb(l(e))
-        
-        list<chnode<LengthType> *> children; // pointers to this nodes children in the component hierarchy
-
-        int level; // this is the 'i' in [v]i
-
         chnode<LengthType> **buckets; // 2-d array of chnodes.  buckets[i] is a doubly-linked list
 
         int *bucketCounts; // 1-d array of ints;
 
-
         LengthType ix0, ixinf, ix; // indices into the buckets; used by Thorup's algorithm F.
 
-
         chnode<LengthType> *next, *prev; // pointers for the doubly-linked list
 
         LengthType minD; // min D value of [v]i \ S
@@ -52,108 +43,122 @@ class chnode {
 
         bool isRoot;
 
-        bool isInS;
-
         int inBucketsCount;
 
-        // parameters:
-        //   lev - the level of this node
-        //   csize - the number of children this node has.
-        chnode(int lev, int csize) : 
-            parent(NULL),vertex(NULL),delta(0),
-            level(lev),
+        chstate() :
             buckets(NULL),bucketCounts(NULL),next(NULL),prev(NULL),
-            minD((LengthType)INT_MAX),bucketNum(-1) {
-            
-        }
-
-        // recursively call's the destructor on it's children
-        ~chnode() {
-            delete [] bucketCounts;
-            delete [] buckets;
+            minD((LengthType)INT_MAX),bucketNum(-1),isRoot(false),
+            inBucketsCount(0) {
         }
 
-        // must be called before a subsequent call to thorup()
+        // must be called before a subsequent call to thorup(). The buckets
+        // belong to the search's Arena, which is reset along with them.
         void init(){
-            if (buckets) {
-                delete[] buckets;
-                buckets = NULL;
-            }
-            if (bucketCounts) {
-                delete[] bucketCounts;
-                bucketCounts = NULL;
-            }
+            buckets = NULL;
+            bucketCounts = NULL;
             minD = (LengthType)INT_MAX;
+            next = prev = NULL;
+            bucketNum = -1;
+            isRoot = false;
+            inBucketsCount = 0;
+        }
+};
+
+// A node of the component hierarchy. Only the structure of the hierarchy
+// is stored here; every method that needs the state of a search takes
+// that search's chstate array, st.
+template <typename LengthType>
+class chnode {
+
+    typedef Vertex<undirectedEdge>* vertptr;
+    typedef chstate<LengthType> state;
+
+    public:
+        chnode *parent; // pointer to this node's parent int he component hierarchy
+
+        Vertex<undirectedEdge> *vertex; // non-NULL when this node represents a single vertex (is a leaf)
+
+        int id; // this chnode's unique identification number
+
+        LengthType delta; // sum of all of the MST edges divided by 2^msb(l(e))
+
+        list<chnode<LengthType> *> children; // pointers to this nodes children in the component hierarchy
+
+        int level; // this is the 'i' in [v]i
+
+        // parameters:
+        //   lev - the level of this node
+        //   csize - the number of children this node has.
+        chnode(int lev, int csize) :
+            parent(NULL),vertex(NULL),delta(0),
+            level(lev) {
+
         }
 
         // this method is called by expandComponent()  It allocates delta()+1 
-        // buckets.
-        void allocBuckets() {
+        // buckets from arena, which frees them when the search is reset.
+        void allocBuckets(state *st, Arena& arena) {
+            state &s = st[id];
             LengthType d = delta + 1;
 
-            if (buckets)
-                delete[] buckets;
-            if (bucketCounts)
-                delete[] bucketCounts;
-            buckets = new chnode<LengthType>*[d];
-            bucketCounts = new int[d];
+            s.buckets = arena.Allocate<chnode<LengthType>*>(d);
+            s.bucketCounts = arena.Allocate<int>(d);
             for (undirectedLength i=0; i< d; i++) {
-                buckets[i] = NULL;
-                bucketCounts[i] = 0;
+                s.buckets[i] = NULL;
+                s.bucketCounts[i] = 0;
             }
             #ifdef DEBUG
 //            printf("allocating %li buckets for node: %i\n",d,id);
             #endif
-            inBucketsCount=0;
+            s.inBucketsCount=0;
         }
 
-        chnode<LengthType>* bucketStart(unsigned i) {
+        chnode<LengthType>* bucketStart(state *st, unsigned i) {
 //            assert (i >= 0 && i < delta+1);
-            return buckets[i];
+            return st[id].buckets[i];
         }
         
-        chnode<LengthType>* bucketEnd(unsigned i) {
-            assert (i >= 0 && i < delta+1);
-            return buckets[i]+bucketCounts[i];
-        }
         // adds node n to bucket i
-        void addToBucket(unsigned i, chnode *n) {
+        void addToBucket(state *st, unsigned i, chnode *n) {
 //            assert (i >= 0 && i < delta+1);
             #ifdef DEBUG
 //            printf("      node: %i addToBucket(bucket=%i,n->id=%i)\n",id,i,n->id);
             #endif
-            chnode<LengthType>* oldFront = buckets[i];
-            n->prev = NULL;
-            n->next = oldFront;
+            state &s = st[id];
+            state &ns = st[n->id];
+            chnode<LengthType>* oldFront = s.buckets[i];
+            ns.prev = NULL;
+            ns.next = oldFront;
             if (oldFront != NULL)
-                oldFront->prev = n;
-            buckets[i] = n;
-            bucketCounts[i]++;
-            n->bucketNum = i;
+                st[oldFront->id].prev = n;
+            s.buckets[i] = n;
+            s.bucketCounts[i]++;
+            ns.bucketNum = i;
 
-            inBucketsCount++;
+            s.inBucketsCount++;
         }
 
         // searches buckets to find the node n, and removes it.
         // returns true on success (n was found).  otherwise 
         // returns false
-        bool removeFromBuckets(chnode *n) {
-            if (n->bucketNum == -1)
+        bool removeFromBuckets(state *st, chnode *n) {
+            state &s = st[id];
+            state &ns = st[n->id];
+            if (ns.bucketNum == -1)
                 return false;
 
-            if (n->prev == NULL) // must pick new front
-                buckets[n->bucketNum] = n->next;
+            if (ns.prev == NULL) // must pick new front
+                s.buckets[ns.bucketNum] = ns.next;
             else 
-                n->prev->next = n->next;
-            if (n->next != NULL)
-                n->next->prev = n->prev;
-
-            bucketCounts[n->bucketNum]--;
-            n->bucketNum=-1;
-            n->next = NULL;
-            n->prev = NULL;
+                st[ns.prev->id].next = ns.next;
+            if (ns.next != NULL)
+                st[ns.next->id].prev = ns.prev;
+            s.bucketCounts[ns.bucketNum]--;
+            ns.bucketNum=-1;
+            ns.next = NULL;
+            ns.prev = NULL;
 
-            inBucketsCount--;
+            s.inBucketsCount--;
 
             #ifdef DEBUG
 //            printf("      node: %i removed child id=%i from buckets\n",id,n->id);
@@ -161,46 +166,48 @@ class chnode {
             return true;
         }
 
-        void rebucket(chnode *n) {
-            bool res = removeFromBuckets(n);
+        void rebucket(state *st, chnode *n) {
+            bool res = removeFromBuckets(st,n);
             if (res == false)
                 return;
-            LengthType index =  ixinf;
-            if (n->getMinD() < (LengthType)INT_MAX) {
-                index = n->getMinD() >> (level - 1);
+            state &s = st[id];
+            LengthType index =  s.ixinf;
+            if (n->getMinD(st) < (LengthType)INT_MAX) {
+                index = n->getMinD(st) >> (level - 1);
                 #ifdef DEBUG
 //                printf("here.. n->getMind() = %li, level1 = %i\n",n->getMinD(),
 //                        level-1);
                 #endif
-                if (index > ixinf)
-                    index = ixinf;
+                if (index > s.ixinf)
+                    index = s.ixinf;
             }
             #ifdef DEBUG
 //            printf("REBUCKET (level=%i): n->id=%i, n->minD=%li, index=%li\n",
 //                    level,n->id,n->minD,index);
             #endif
-            addToBucket(index - ix0,n);
+            addToBucket(st,index - s.ix0,n);
         }
 
         // A node is said to be "empty" when all the vertices in the node are
         // in S.  
-        bool isEmpty() { return inBucketsCount == 0; } 
+        bool isEmpty(state *st) { return st[id].inBucketsCount == 0; }
 
         // If allocBuckets wasn't called yet, then this node is unvisited
-        bool isUnvisited() { return buckets == NULL; }
+        bool isUnvisited(state *st) { return st[id].buckets == NULL; }
 
         // returns true if this node is a root in the component hierarchy.
-        bool isUnvisitedRoot() { return isRoot && isUnvisited(); }
+        bool isUnvisitedRoot(state *st)
+            { return st[id].isRoot && isUnvisited(st); }
 
         // returns the root of the tree in the component hierarchy to which
         // this node belongs.
-        chnode * unvisitedRoot() {
-            if (isRoot)
+        chnode * unvisitedRoot(state *st) {
+            if (st[id].isRoot)
                 return this;
 
             chnode *root = parent;
 
-            while (root && !root->isUnvisitedRoot())
+            while (root && !root->isUnvisitedRoot(st))
                 root = root->parent;
 
             return root;
@@ -208,16 +215,16 @@ class chnode {
 
         // returns the first node that is an ancestor of this node
         // that has been visited.
-        chnode * visitedParent() {
+        chnode * visitedParent(state *st) {
             chnode *visParent = parent;
 
-            while (visParent && visParent->isUnvisited())
+            while (visParent && visParent->isUnvisited(st))
                 visParent = visParent->parent;
 
             return visParent;
         }
 
-        LengthType getMinD() { return minD; }
+        LengthType getMinD(state *st) { return st[id].minD; }
 
         // The component maintains a minimum D-value for vertices in its component
         // not in the set S (vertices with known distances).  When a vertex from the
@@ -230,16 +237,17 @@ class chnode {
         //   valLost - the value that a child reports as no longer available as part of
         //   the component.
         // 
-        void updateMinD(LengthType valLost) {
+        void updateMinD(state *st, LengthType valLost) {
             #ifdef DEBUG
 //            printf("node: %i updateMinD... valLost=%li minD=%li\n",id,valLost,minD);
             #endif
+            LengthType &minD = st[id].minD;
 
             if (valLost == minD) {
                 LengthType best = (LengthType)INT_MAX;
                 typename list<chnode<LengthType>*>::iterator it;
                 for (it = children.begin(); it != children.end(); it++) {
-                    LengthType x = (*it)->getMinD();
+                    LengthType x = (*it)->getMinD(st);
                     if ( x < best)
                         best = x;
                 }
@@ -251,12 +259,12 @@ class chnode {
 
             if (minD > valLost && parent != NULL) {
                 // must rebucket in parents buckets, if needbe
-                parent->rebucket(this);
+                parent->rebucket(st,this);
                 // most tell our parent. Two cases.
                 // 1. valLost wasn't the minD, nothing happens.
                 // 2. valLost was the minD, then either our new minD will become parents
                 //    new minD or our parent will get a minD from some other child.
-                parent->updateMinD(valLost);
+                parent->updateMinD(st,valLost);
             }
 
         }
@@ -267,18 +275,18 @@ class chnode {
         // parameters:
         //   newVal - the proposed new value for minD.
         //
-        void decreaseMinD(LengthType newVal) {
+        void decreaseMinD(state *st, LengthType newVal) {
             assert (newVal > 0);
             //if (   (parent != NULL && (newVal >> (parent->level - 1)) < (minD >> (parent->level - 1)))
             //    || (parent == NULL && (newVal < minD)) ) {
-            if(newVal < minD) {
+            if(newVal < st[id].minD) {
                 #ifdef DEBUG 
 //                printf("      node: %i decreaseMinD(%li) -- decreased minD=%li\n",id,newVal,minD);
                 #endif
-                minD = newVal;
+                st[id].minD = newVal;
                 if (parent != NULL) {
-                    parent->rebucket(this);
-                    parent->decreaseMinD(newVal);
+                    parent->rebucket(st,this);
+                    parent->decreaseMinD(st,newVal);
                 }
             }
             else {
@@ -15,7 +15,7 @@
 #include <exception>
 
 #include "../location/location.hpp"
-#include "../polygon/AdjacencyMatrix.h"
+#include "../polygon/AdjacencyGraph.h"
 
 #include "Graph.h"
 
@@ -48,7 +48,7 @@ void parse(ifstream &infile,
            bool undirected=false);
 
 template<typename LengthType, typename edgeType>
-void matrix_to_arrays(AdjacencyMatrix& A,
+void matrix_to_arrays(AdjacencyGraph& A,
            PathMatrix& P,
            int numVerts,
 		   int& numEdges,
@@ -277,7 +277,7 @@ void parse(ifstream &infile,
 //    edges,source,inEdges,fromVertices,start,true);
 
 template<typename LengthType, typename edgeType>
-void matrix_to_arrays(AdjacencyMatrix& A,
+void matrix_to_arrays(AdjacencyGraph& A,
            PathMatrix& P,
            int numVerts,
 		   int& numEdges,
@@ -0,0 +1,333 @@
+/* 
+ * Copyright 2009, 2010, Jake Askeland, jake(dot)askeland(at)gmail(dot)com
+ * 
+ *  * This program is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     This program is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ *  * This file is part of Topological all shortest paths automatique' (TASPA).
+ * 
+ *     TASPA is free software: you can redistribute it and/or modify
+ *     it under the terms of the GNU General Public License as published by
+ *     the Free Software Foundation, either version 3 of the License, or
+ *     (at your option) any later version.
+ * 
+ *     TASPA is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ * 
+ *     You should have received a copy of the GNU General Public License
+ *     along with TASPA.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SSSP_H
+#define SSSP_H
+
+#include <vector>
+#include <algorithm>
+#include <limits.h>
+#include "Graph.h"
+#include "ch.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/** Single source shortest paths over the vertex and edge arrays built by
+	matrix_to_arrays. A search leaves its results in dist and pred, each
+	numVerts+1 long: dist is INT_MAX and pred NULL for every vertex the 
+	source cannot reach, and pred of the source is the source.
+
+	Where a vertex has several shortest paths, which one an algorithm
+	finds depends on the order it visits vertices in. Search therefore
+	sets pred of every other vertex to its least numbered neighbour on a 
+	shortest path, so every algorithm leaves the same pred.
+
+	A search only reads the arrays, so any number of searches, each with
+	its own dist and pred, may run over the same graph at once.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class ShortestPathSearch {
+
+	protected:
+		Vertex<undirectedEdge>* vertices;
+		int numVerts;
+		undirectedLength* dist;
+		Vertex<undirectedEdge>** pred;
+
+		void Clear() {
+			for (int i = 0; i <= numVerts; i ++) {
+				dist[i] = INT_MAX;
+				pred[i] = NULL;
+			}
+		}
+
+		// Fills dist and pred with the paths from #source#, breaking ties
+		// however the algorithm likes.
+		virtual void Run(Vertex<undirectedEdge>* source) = 0;
+
+		// Sets pred of each reached vertex other than #source# to its 
+		// least numbered neighbour on a shortest path. Edges are 
+		// undirected, so an edge out of v is also an edge into it.
+		void BreakTies(Vertex<undirectedEdge>* source) {
+			for (int i = 0; i <= numVerts; i ++) {
+				if (i == source->id || pred[i] == NULL) continue;
+
+				Vertex<undirectedEdge>* v = &vertices[i];
+				Vertex<undirectedEdge>* best = pred[i];
+				for (undirectedEdge* it = v->first; it != v->last(); it ++) {
+					Vertex<undirectedEdge>* u = it->other;
+					if (u->id < best->id && 
+						dist[u->id] + it->length == dist[i]) best = u;
+				}
+				pred[i] = best;
+			}
+		}
+
+	public:
+		ShortestPathSearch(Vertex<undirectedEdge>* _vertices, int _numVerts,
+			undirectedLength* _dist, Vertex<undirectedEdge>** _pred) :
+			vertices(_vertices), numVerts(_numVerts), dist(_dist), 
+			pred(_pred) { }
+
+		virtual ~ShortestPathSearch() { }
+
+		/** Fills dist and pred with the paths from #source#. */
+		void Search(Vertex<undirectedEdge>* source) {
+			Run(source);
+			BreakTies(source);
+		}
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/** Thorup's algorithm over a component hierarchy built once for the graph 
+	and shared by every search.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class ThorupSearch : public ShortestPathSearch {
+
+	private:
+		bool* S;
+		CHSearch<undirectedLength> search;
+
+		ThorupSearch(const ThorupSearch&);
+		ThorupSearch& operator= (const ThorupSearch&);
+
+	public:
+		ThorupSearch(const ComponentHierarchy<undirectedLength>& ch,
+			Vertex<undirectedEdge>* _vertices, int _numVerts,
+			undirectedLength* _dist, Vertex<undirectedEdge>** _pred) :
+			ShortestPathSearch(_vertices, _numVerts, _dist, _pred),
+			S(new bool[_numVerts+1]),
+			search(ch, _numVerts, S, _dist, _pred) { }
+
+		~ThorupSearch() { delete []S; }
+
+	protected:
+		void Run(Vertex<undirectedEdge>* source) { search.thorup(source); }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/** Dijkstra's algorithm with an Arity-ary heap of vertex ids, keyed by dist
+	and indexed by pos so a vertex's key is decreased in place.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+template<int Arity>
+class HeapSearch : public ShortestPathSearch {
+
+	private:
+		std::vector<int> heap;
+		std::vector<int> pos;       // Index in heap; -1 if never in it
+
+		void SiftUp(int i) {
+			int v = heap[i];
+			undirectedLength key = dist[v];
+			while (i > 0) {
+				int p = (i-1)/Arity;
+				if (dist[heap[p]] <= key) break;
+				heap[i] = heap[p];
+				pos[heap[i]] = i;
+				i = p;
+			}
+			heap[i] = v;
+			pos[v] = i;
+		}
+
+		void SiftDown(int i) {
+			int v = heap[i];
+			undirectedLength key = dist[v];
+			int n = (int)heap.size();
+			for (;;) {
+				int c = i*Arity + 1;
+				if (c >= n) break;
+				int end = (c + Arity < n) ? c + Arity : n;
+				int best = c;
+				for (int k = c+1; k < end; k ++) 
+					if (dist[heap[k]] < dist[heap[best]]) best = k;
+				if (dist[heap[best]] >= key) break;
+				heap[i] = heap[best];
+				pos[heap[i]] = i;
+				i = best;
+			}
+			heap[i] = v;
+			pos[v] = i;
+		}
+
+		int PopMin() {
+			int v = heap[0];
+			int last = heap.back();
+			heap.pop_back();
+			if (!heap.empty()) {
+				heap[0] = last;
+				SiftDown(0);
+			}
+			return v;
+		}
+
+	public:
+		HeapSearch(Vertex<undirectedEdge>* _vertices, int _numVerts,
+			undirectedLength* _dist, Vertex<undirectedEdge>** _pred) :
+			ShortestPathSearch(_vertices, _numVerts, _dist, _pred),
+			pos(_numVerts+1, -1) { heap.reserve(_numVerts+1); }
+
+	protected:
+		void Run(Vertex<undirectedEdge>* source) {
+			Clear();
+			heap.clear();
+			std::fill(pos.begin(), pos.end(), -1);
+
+			dist[source->id] = 0;
+			pred[source->id] = source;
+			heap.push_back(source->id);
+			pos[source->id] = 0;
+
+			while (!heap.empty()) {
+				Vertex<undirectedEdge>* v = &vertices[PopMin()];
+				
+				for (undirectedEdge* it = v->first; it != v->last(); it ++) {
+					int w = it->other->id;
+					undirectedLength d = dist[v->id] + it->length;
+					if (d >= dist[w]) continue;
+
+					dist[w] = d;
+					pred[w] = v;
+					if (pos[w] == -1) {
+						heap.push_back(w);
+						pos[w] = (int)heap.size()-1;
+					}
+					SiftUp(pos[w]);
+				}
+			}
+		}
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+/** Dijkstra's algorithm with a radix heap. Keys are integer and never less
+	than the last one popped, so an entry belongs in the bucket numbered 
+	by the highest bit in which its key differs from that last key. 
+	Entries whose key was decreased since they were pushed are skipped 
+	when popped.
+
+	@version 0.1.0 Build 0
+	@author J. Askeland
+	@memo
+*/
+class RadixHeapSearch : public ShortestPathSearch {
+
+	private:
+		struct Entry {
+			undirectedLength key;
+			int v;
+			Entry(undirectedLength _key, int _v) : key(_key), v(_v) { }
+		};
+
+		std::vector< std::vector<Entry> > buckets;
+		undirectedLength last;      // Key last popped
+		std::vector<bool> done;
+
+		int Bucket(undirectedLength key) const {
+			unsigned long x = (unsigned long)(key ^ last);
+			return (x == 0) ? 0 : (int)(sizeof(unsigned long)*8) - 
+				__builtin_clzl(x);
+		}
+
+		void Push(undirectedLength key, int v) {
+			buckets[Bucket(key)].push_back(Entry(key, v));
+		}
+
+		// Moves the entries of the first nonempty bucket into lower ones,
+		// so bucket 0 holds the least key. False if the heap is empty.
+		bool Refill() {
+			if (!buckets[0].empty()) return true;
+
+			size_t i = 1;
+			while (i < buckets.size() && buckets[i].empty()) i ++;
+			if (i == buckets.size()) return false;
+
+			std::vector<Entry>& b = buckets[i];
+			last = b[0].key;
+			for (size_t k = 1; k < b.size(); k ++) 
+				if (b[k].key < last) last = b[k].key;
+			for (size_t k = 0; k < b.size(); k ++) Push(b[k].key, b[k].v);
+			b.clear();
+			return true;
+		}
+
+	public:
+		RadixHeapSearch(Vertex<undirectedEdge>* _vertices, int _numVerts,
+			undirectedLength* _dist, Vertex<undirectedEdge>** _pred) :
+			ShortestPathSearch(_vertices, _numVerts, _dist, _pred),
+			buckets(sizeof(unsigned long)*8 + 1), last(0), 
+			done(_numVerts+1) { }
+
+	protected:
+		void Run(Vertex<undirectedEdge>* source) {
+			Clear();
+			for (size_t i = 0; i < buckets.size(); i ++) buckets[i].clear();
+			done.assign(done.size(), false);
+			last = 0;
+
+			dist[source->id] = 0;
+			pred[source->id] = source;
+			Push(0, source->id);
+
+			while (Refill()) {
+				Entry e = buckets[0].back();
+				buckets[0].pop_back();
+				if (done[e.v] || e.key != dist[e.v]) continue;
+				done[e.v] = true;
+
+				Vertex<undirectedEdge>* v = &vertices[e.v];
+				for (undirectedEdge* it = v->first; it != v->last(); it ++) {
+					int w = it->other->id;
+					undirectedLength d = e.key + it->length;
+					if (d >= dist[w]) continue;
+
+					dist[w] = d;
+					pred[w] = v;
+					Push(d, w);
+				}
+			}
+		}
+};
+
+#endif
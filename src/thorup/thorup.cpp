@@ -7,6 +7,8 @@
  */
 #include<string>
 #include<fstream>
+#include<vector>
+#include<pthread.h>
 
 #include "../stopwatch/Stopwatch.h"
 #include "thorup.h"
@@ -16,6 +18,7 @@
 #include "timer.h"
 #include "ch.h"
 #include "kruskal.h"
+#include "sssp.h"
 
 undirectedLength L2scaled(location src, location dest, undirectedLength scale) 
 {
@@ -24,12 +27,171 @@ undirectedLength L2scaled(location src, location dest, undirectedLength scale)
         +   (src.y-dest.y)*(src.y-dest.y)*scale*scale); 
 }
 
+
+///////////////////////////////////////////////////////////////////////
+// State shared by every worker of ThorupPaths. The graph arrays and the
+// component hierarchy, built only for THORUP_SSSP, are only read; the next
+// source to process, the progress count and the output stream are guarded
+// by lock.
+struct ThorupShared
+{
+    PathMatrix& P;
+    PathRowWriter* rows;
+    SsspEngine engine;
+    const ComponentHierarchy<undirectedLength>* ch;
+    Vertex<undirectedEdge>* vertices;
+    int numVerts;
+    std::ostream& out;
+
+    pthread_mutex_t lock;
+    int firstSource;        // Sources before it were found by an earlier run
+    int nextSource;
+    int finished;
+    Stopwatch timer;
+
+    ThorupShared(PathMatrix& _P, PathRowWriter* _rows, SsspEngine _engine,
+        const ComponentHierarchy<undirectedLength>* _ch,
+        Vertex<undirectedEdge>* _vertices, int _numVerts, std::ostream& _out) :
+        P(_P), rows(_rows), engine(_engine), ch(_ch), vertices(_vertices), 
+        numVerts(_numVerts), out(_out), firstSource(0), nextSource(0), 
+        finished(0)
+    { 
+        pthread_mutex_init(&lock, NULL); 
+        timer.Start();
+    }
+
+    ~ThorupShared() { pthread_mutex_destroy(&lock); }
+};
+
+
+///////////////////////////////////////////////////////////////////////
+// One worker's scratch space. dist and pred are numVerts+1 long.
+struct ThorupWorker
+{
+    ThorupShared* shared;
+    pthread_t thread;
+    undirectedLength* dist;
+    Vertex<undirectedEdge>** pred;
+
+    ThorupWorker() : shared(0), dist(0), pred(0) { }
+};
+
+
+///////////////////////////////////////////////////////////////////////
+// FNV-1a hash of P's vertex list and of each vertex's edges, which are
+// all ThorupPaths finds paths from, so a checkpoint is only resumed over
+// the same graph.
+static uint64_t GraphIdentity(PathMatrix& P, 
+    Vertex<undirectedEdge>* vertices, int numVerts)
+{
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    
+    const std::vector<location>& verts = P.GetIntToVer();
+    for (size_t i = 0; i < verts.size(); i ++) {
+        h = (h ^ (uint64_t)(uint32_t)verts[i].x) * prime;
+        h = (h ^ (uint64_t)(uint32_t)verts[i].y) * prime;
+    }
+    for (int v = 0; v <= numVerts; v ++) {
+        h = (h ^ (uint64_t)vertices[v].edgeCount) * prime;
+        for (undirectedEdge* it = vertices[v].first; 
+            it != vertices[v].last(); it ++) {
+            h = (h ^ (uint64_t)it->other->id) * prime;
+            h = (h ^ (uint64_t)it->length) * prime;
+        }
+    }
+    return h;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// A search of the shared engine, leaving its results in w's dist and pred.
+static ShortestPathSearch* NewSearch(ThorupWorker* w)
+{
+    ThorupShared& sh = *w->shared;
+    switch (sh.engine) {
+    case BINARY_HEAP_SSSP: 
+        return new HeapSearch<2>(sh.vertices, sh.numVerts, w->dist, w->pred);
+    case QUAD_HEAP_SSSP:
+        return new HeapSearch<4>(sh.vertices, sh.numVerts, w->dist, w->pred);
+    case RADIX_HEAP_SSSP:
+        return new RadixHeapSearch(sh.vertices, sh.numVerts, w->dist, w->pred);
+    default:
+        return new ThorupSearch(*sh.ch, 
+            sh.vertices, sh.numVerts, w->dist, w->pred);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// Runs the shared engine from each source handed out by the shared counter
+// until none are left, storing each source's paths in P or putting them to
+// the shared PathRowWriter. Only the paths to the source's own component
+// of P are extracted; there are none to the others.
+static void* ThorupWorkerMain(void* arg)
+{
+    ThorupWorker* w = static_cast<ThorupWorker*>(arg);
+    ThorupShared& sh = *w->shared;
+    PathMatrix& P = sh.P;
+    int numVerts = sh.numVerts;
+
+    ShortestPathSearch* search = NewSearch(w);
+    std::vector<PathStep> row(numVerts);
+
+    for (;;) 
+    {
+        pthread_mutex_lock(&sh.lock);
+        int v = sh.nextSource++;
+        pthread_mutex_unlock(&sh.lock);
+        
+        if (v >= numVerts) break;
+
+        search->Search(&sh.vertices[v]);
+        
+        const PathComponents& components = P.GetComponents();
+        int c = components.Of(v);
+        
+        PathMatrix::EdgeIter e(&P, v, components.Begin(c));
+        for (; e.Row() < components.End(c); e.NextRow())
+        {
+            std::vector<int> path = e.ExtractPath(w->pred);
+            row[e.Row()] = path.empty() ? PathStep() : 
+                PathStep(path[0], w->dist[e.Row()]);
+        }
+        row[v] = PathStep(v,0);
+        
+        if (sh.rows) sh.rows->Put(v, row);
+        else P.StoreRow(v, row);
+
+        pthread_mutex_lock(&sh.lock);
+        int done = ++sh.finished;
+        
+        float etc = (float)(numVerts - done) * 
+            (sh.timer.Lap()/(float)(done - sh.firstSource));
+        
+        char hrs[4];
+        char min[3];
+        char sec[3]; 
+        
+        sprintf(hrs, "%03d", (int)(floorf(etc/3600.)));
+        sprintf(min, "%02d", (int)(floorf(etc/60.))%60);
+        sprintf(sec, "%02d", (int)(etc)%60);
+        
+	    sh.out << done << " / " << numVerts << " vertices processed.  T-" 
+            << hrs << ":" << min << ":" << sec << "   \r";
+	    sh.out.flush();
+        pthread_mutex_unlock(&sh.lock);
+	}
+
+    delete search;
+    return 0;
+}
+
+
 void ThorupPaths
-(PathMatrix& P, AdjacencyMatrix& A, std::ostream& out) 
+(PathMatrix& P, AdjacencyGraph& A, std::ostream& out, int numThreads,
+    SsspEngine engine, PathRowWriter* rows) 
 {
-	Stopwatch timer;
-    timer.Start();
-	
     int numVerts = P.Height();
 	int numEdges = A.TotalEdgeCount() - numVerts; // (All edges) - (self edges)
 
@@ -44,22 +206,15 @@ void ThorupPaths
     undirectedEdge* inEdges  = new (std::nothrow) undirectedEdge[numEdges];
     undirectedEdge* edges    = new (std::nothrow) undirectedEdge[numEdges];
 	int* start               = new (std::nothrow) int[numVerts+1];
-    Vertex<undirectedEdge>** pred = 
-        new (std::nothrow) Vertex<undirectedEdge>*[numVerts+1];
-    undirectedLength* dist   = new (std::nothrow) undirectedLength[numVerts+1];
-    bool* S                  = new (std::nothrow) bool[numVerts+1];
     undirectedEdge* mstEdges = new (std::nothrow) undirectedEdge[numVerts-1];
     
     if (!vertices || ! fromVertices || !inEdges || !edges || !start ||
-        !pred || !dist || !S || !mstEdges) {            
+        !mstEdges) {            
             if (vertices)       delete[] vertices;
             if (fromVertices)   delete[] fromVertices;
             if (inEdges)        delete[] inEdges;
             if (edges)          delete[] edges;
             if (start)          delete[] start;
-            if (pred)           delete[] pred;
-            if (dist)           delete[] dist;
-            if (S)              delete[] S;
             if (mstEdges)       delete[] mstEdges;
             
             std::cerr << "Could not allocate enough contiguous memory.\n";
@@ -70,19 +225,23 @@ void ThorupPaths
 	int from, to; 
 	
     ///////////////////////////////////////////////////////////////////
-    // Visit all edges in the adjacency matrix and add the information 
-    // to various arrays.
+    // Visit all edges in the adjacency graph and add the information 
+    // to various arrays. Each of the graph's vertex ids is looked up in
+    // P only once.
+
+    std::vector<int> idInP(A.size());
+    for (int v = 0; v < A.size(); v++) idInP[v] = P.VerToInt(A.IntToVer(v));
         
     undirectedLength s = 2*numVerts-1;
-    AdjacencyMatrix::EdgeIter e = A.GetEdgeIterator();
+    AdjacencyGraph::EdgeIter e = A.GetEdgeIterator();
     for (e.ResetCol(); e.HasNextCol(); e.NextCol()) {
         
-        from = P.VerToInt(e.ColLoc());
+        from = idInP[e.Col()];
         if (from == INT_MAX) continue;
         
     for (e.ResetRow(); e.HasNextRow(); e.NextRow()) {
 
-        to   = P.VerToInt(e.RowLoc());
+        to   = idInP[e.Row()];
         if (to == INT_MAX) continue;
         if (to == from) continue;
         assert (to != INT_MAX);
@@ -99,54 +258,76 @@ void ThorupPaths
 	
 
     ///////////////////////////////////////////////////////////////////
-    // Complete thorup's for each vertex as source
+    // The edge arrays, minimum spanning tree and component hierarchy
+    // depend only on the graph, so they are built once and shared by 
+    // every source. Only Thorup's algorithm uses the hierarchy.
 
-    for (int v = 0; v < numVerts; v++) 
-	{
-        Vertex<undirectedEdge>* source;
+    Vertex<undirectedEdge>* source;
 
-        matrix_to_arrays<undirectedLength,undirectedEdge>
-            (A,P,numVerts,numEdges,v,vertices,
-            edges,source,inEdges,fromVertices,start,true);
+    matrix_to_arrays<undirectedLength,undirectedEdge>
+        (A,P,numVerts,numEdges,0,vertices,
+        edges,source,inEdges,fromVertices,start,true);
 
-        ComponentHierarchy<undirectedLength> 
-            ch(S,vertices,numVerts,edges,numEdges,dist,pred);
-        ch.compute(mstEdges);
-        ch.thorup(vertices,numVerts,source);
-        
-        PathMatrix::EdgeIter e = P.GetEdgeIterator(v);
-        for (e.ResetRow(); e.HasNextRow(); e.NextRow())
-        {
-            std::vector<int> path = e.ExtractPath(pred);
-            e.StorePath(path, dist);
-        }
-        P.SetValue(v,v,v,0);
+    ComponentHierarchy<undirectedLength> 
+        ch(vertices,numVerts,edges,numEdges);
+    if (engine == THORUP_SSSP) ch.compute(mstEdges);
 
-        float etc = (float)(numVerts - v - 1) * (timer.Lap()/(float)(v+1));
-        
-        char hrs[4];
-        char min[3];
-        char sec[3]; 
-        
-        sprintf(hrs, "%03d", (int)(floorf(etc/3600.)));
-        sprintf(min, "%02d", (int)(floorf(etc/60.))%60);
-        sprintf(sec, "%02d", (int)(etc)%60);
-        
-	    out << v+1 << " / " << numVerts << " vertices processed.  T-" 
-            << hrs << ":" << min << ":" << sec << "   \r";
-	    out.flush();
-	}
-	
-    delete []dist;
-    delete []pred;
-    delete []vertices;
-    delete []edges;
     delete []fromVertices;
     delete []inEdges;
     delete []start;
-    delete []S;
     delete []mstEdges;
 
+    ///////////////////////////////////////////////////////////////////
+    // Run the engine from each vertex as source. Each worker thread
+    // takes the next unprocessed source and fills that source's entries
+    // of P, using its own dist, pred and search state.
+
+    if (numThreads < 1) numThreads = 1;
+    if (numThreads > numVerts) numThreads = numVerts;
+
+    ThorupShared shared(P, rows, engine, &ch, vertices, numVerts, out);
+    
+    if (rows) {
+        shared.firstSource = rows->Start(GraphIdentity(P, vertices, numVerts));
+        shared.nextSource = shared.finished = shared.firstSource;
+        if (shared.firstSource > 0) out << "Resuming after " 
+            << shared.firstSource << " vertices.\n";
+    }
+    std::vector<ThorupWorker> workers(numThreads);
+
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].shared = &shared;
+        workers[t].dist = new (std::nothrow) undirectedLength[numVerts+1];
+        workers[t].pred = 
+            new (std::nothrow) Vertex<undirectedEdge>*[numVerts+1];
+
+        if (!workers[t].dist || !workers[t].pred) {
+            std::cerr << "Could not allocate enough contiguous memory.\n";
+            numThreads = t;
+            break;
+        }
+    }
+
+    // Thread 0 is the calling thread.
+    int started = 1;
+    for (; started < numThreads; started++) {
+        if (pthread_create(&workers[started].thread, NULL, 
+            ThorupWorkerMain, &workers[started]) != 0) {
+            std::cerr << "Could not start worker thread " 
+                << started << ".\n";
+            break;
+        }
+    }
+    if (numThreads > 0) ThorupWorkerMain(&workers[0]);
+    for (int t = 1; t < started; t++) pthread_join(workers[t].thread, NULL);
+
+    for (size_t t = 0; t < workers.size(); t++) {
+        if (workers[t].dist) delete []workers[t].dist;
+        if (workers[t].pred) delete []workers[t].pred;
+    }
+
+    delete []vertices;
+    delete []edges;
+
 	out << "\n";
 }
-
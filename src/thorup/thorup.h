@@ -36,11 +36,28 @@
 #include <iostream>
 
 #include "PathMatrix.h"
-#include "../polygon/AdjacencyMatrix.h"
+#include "../polygon/AdjacencyGraph.h"
+
+// Algorithms ThorupPaths may run from each source. See sssp.h.
+enum SsspEngine {
+    THORUP_SSSP,        // Thorup's algorithm over a component hierarchy
+    BINARY_HEAP_SSSP,   // Dijkstra's algorithm with a binary heap
+    QUAD_HEAP_SSSP,     // Dijkstra's algorithm with a 4-ary heap
+    RADIX_HEAP_SSSP     // Dijkstra's algorithm with a radix heap
+};
 
 undirectedLength L2scaled(location src, location dest, undirectedLength scale); 
 
+/** Fills P with the shortest paths between every pair of its vertices,
+    over the edges in A, running engine from each source. Sources are 
+    processed by numThreads threads, each filling only the entries of P 
+    belonging to the sources it was given. Every engine fills P alike.
+    
+    Given an open PathRowWriter, each source's row is put to rows instead 
+    of being stored in P, whose entries then need not be allocated.
+*/
 void ThorupPaths
-(PathMatrix& P, AdjacencyMatrix& A, std::ostream& out);
+(PathMatrix& P, AdjacencyGraph& A, std::ostream& out, int numThreads = 1,
+    SsspEngine engine = THORUP_SSSP, PathRowWriter* rows = NULL);
 
 #endif
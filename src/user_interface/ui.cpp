@@ -36,6 +36,7 @@
 #include "ui.h"
 #include <iostream>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -51,7 +52,12 @@ Thorup's SSSP algorithm from each vertex to generate a matrix whose entries\n\
 
 const char brief_usage[] = "Brief USAGE: \n\
 	taspa [-l <log_file>] [-r <report_file>] [-d <distiller_name>] \n\
-	      [-w] [-s] [-v] [-h] [-p] [--] <input_image> <output_image>\n\n";
+	      [-j <threads>] [-e <edge_builder>] [-f <path_layout>] \n\
+	      [-a <sssp_engine>] [-i <block_size>] [-c <radius>] \n\
+	      [-t <tile_size>] [-n <vertex_order>] [-q <query_file>] \n\
+	      [-w] [-s] [-v] [-h] [-p] [-o] [--resume] \n\
+	      [--checkpoint <seconds>] [--] \n\
+	      <input_image> <output_image>\n\n";
 
 
 const char extended_usage[] = "Where: \n\
@@ -59,12 +65,56 @@ const char extended_usage[] = "Where: \n\
    -l <log_file>        Append log events to [log_file].\n\
    -r <report_file>     Append report to [report_file].\n\
    -d <distiller_name>  Specify a distiller.\n\
+   -c <radius>          Half width, in pixels, of the \"footprint\"\n\
+                        distiller's square window (default 4, 9x9).\n\
+   -j <threads>         Find boundaries, edge weights and shortest paths\n\
+                        with <threads> threads.\n\
+   -e <edge_builder>    Find visible vertex pairs by \"bresenham\" (default),\n\
+                        \"sweep\", or \"validate\" (both, reporting any\n\
+                        disagreement).\n\
+   -f <path_layout>     Store the path matrix as \"wide\" (default, 16\n\
+                        bytes per entry), \"compact\" (8 bytes), or next\n\
+                        hops only as \"next32\" (4 bytes) or \"next16\" (2\n\
+                        bytes, under 65535 vertices). Next hop only\n\
+                        layouts recompute path lengths when asked.\n\
+                        \"symmetric\" keeps next hops and one length\n\
+                        per vertex pair (about 6 bytes).\n\
+   -a <sssp_engine>     Find the paths from each vertex by \"thorup\"\n\
+                        (default), or by Dijkstra's algorithm with a\n\
+                        \"binary\", \"4ary\" or \"radix\" heap. All fill\n\
+                        the path matrix alike.\n\
+   -i <block_size>      Index the vertices visible from each <block_size>\n\
+                        square block of pixels to speed up path queries.\n\
+   -t <tile_size>       Find paths within each <tile_size> square tile of\n\
+                        pixels and between the tiles' borders instead of\n\
+                        among all vertices at once, for maps too large for\n\
+                        one path matrix. Paths may be a little longer\n\
+                        than the shortest. Not saved by -p or -o.\n\
+   -n <vertex_order>    Number the vertices of the path matrix as their\n\
+                        locations sort, x-major, as \"sorted\" (default),\n\
+                        or along a \"hilbert\" or \"zorder\" curve, so that\n\
+                        nearby vertices get nearby rows.\n\
+   -q <query_file>      Answer each source and destination pair of\n\
+                        <query_file>, \"src_x,src_y,dest_x,dest_y\" lines\n\
+                        if it is named *.csv or else four 32 bit integers\n\
+                        per pair, on <threads> threads. Writes each path's\n\
+                        length and waypoints to <query_file>.out, or\n\
+                        <name>.out.csv for a .csv file, and reports the\n\
+                        queries per second. Without -p or -o the path\n\
+                        matrix is mapped from <output_image>.path if there\n\
+                        is one rather than found again.\n\
    -w  Consider boundary words as log events (needs -l).\n\
    -s                   Send log events to stdout.\n\
    -v                   Print details to stdout.\n\
    --                   Ignores further arguments.\n\
    -h                   Displays usage information and exits.\n\
    -p                   Save all pairs path matrix to <output_image>.path\n\
+   -o                   As -p, but write each row as soon as it is found,\n\
+                        never holding the whole matrix in memory.\n\
+   --resume             As -o, but go on from the last checkpoint of\n\
+                        <output_image>.path if it is of the same graph.\n\
+   --checkpoint <seconds>  Checkpoint -o and --resume runs every\n\
+                        <seconds> seconds (default 60).\n\
    <input_image>        (required)  Input image filename.\n\
    <output_image>       (required)  Output image filename, no extension.\n\
 	\n\n";
@@ -95,29 +145,91 @@ bool GetCommandLineInput ( std::string& inFilename, std::string& outFilename,
 		std::string& logFilename, std::string& reportFilename, std::string&
 		distillerName,
 		bool& appendToLog, bool& verbose, bool& logToStdout, bool& saveLots, 
-		bool& saveReport, bool& savePaths, int argc, char* argv[] ) {
+		bool& saveReport, bool& savePaths, bool& streamPaths, 
+		bool& resumePaths, int& checkpointSeconds, int& numThreads, 
+		std::string& edgeBuilderName, std::string& pathLayoutName, 
+		std::string& ssspEngineName, std::string& vertexOrderName,
+		std::string& queryFilename, int& indexBlockSize, int& footprintRadius, int& tileSize, 
+		int argc, char* argv[] ) {
 	
 	////////////////////////////////////////////////////////////
 	/* Get command line arguments */
 
-	char c;
+	int c;
 	opterr = 0;
 
-	while ((c = getopt (argc, argv, "l:r:d:pvswh")) != -1)
+	// Long options only; each returns a value no short option uses.
+	static struct option longOptions[] = {
+		{ "resume",     no_argument,       0, 'R' },
+		{ "checkpoint", required_argument, 0, 'K' },
+		{ 0, 0, 0, 0 }
+	};
+
+	while ((c = getopt_long (argc, argv, "l:r:d:j:e:f:a:i:c:t:n:q:povswh",
+			longOptions, 0)) != -1)
 	 switch (c)
 	   {
 	   case 'v': verbose = true;              break;
 	   case 's': logToStdout = true;          break;
 	   case 'w': saveLots = true;             break;
       case 'p': savePaths = true;            break;
+	   case 'o': savePaths = streamPaths = true; break;
+	   case 'R': savePaths = streamPaths = resumePaths = true; break;
+	   case 'K': 
+		 checkpointSeconds = atoi(optarg);
+		 if (checkpointSeconds < 1) {
+		   fprintf (stderr, 
+			 "Option --checkpoint requires a positive integer.\n");
+		   return false;
+		 }
+		 break;
 	   case 'l': logFilename = optarg;        break;
 	   case 'r': reportFilename = optarg;     break;
 	   case 'd': distillerName = optarg;      break;
+	   case 'e': edgeBuilderName = optarg;    break;
+	   case 'f': pathLayoutName = optarg;     break;
+	   case 'a': ssspEngineName = optarg;     break;
+	   case 'n': vertexOrderName = optarg;    break;
+	   case 'q': queryFilename = optarg;      break;
+	   case 'j': 
+		 numThreads = atoi(optarg);
+		 if (numThreads < 1) {
+		   fprintf (stderr, "Option -j requires a positive integer.\n");
+		   return false;
+		 }
+		 break;
+	   case 'i': 
+		 indexBlockSize = atoi(optarg);
+		 if (indexBlockSize < 1) {
+		   fprintf (stderr, "Option -i requires a positive integer.\n");
+		   return false;
+		 }
+		 break;
+	   case 'c': 
+		 footprintRadius = atoi(optarg);
+		 if (footprintRadius < 0) {
+		   fprintf (stderr, "Option -c requires a non-negative integer.\n");
+		   return false;
+		 }
+		 break;
+	   case 't': 
+		 tileSize = atoi(optarg);
+		 if (tileSize < 1) {
+		   fprintf (stderr, "Option -t requires a positive integer.\n");
+		   return false;
+		 }
+		 break;
 	   case 'h': PrintSyntax(argv[0],c); return false;
 	   case '?':
-		 if (optopt == 'l' || optopt == 'r' || optopt == 'd')
+		 if (optopt == 'l' || optopt == 'r' || optopt == 'd' || 
+			 optopt == 'j' || optopt == 'e' || optopt == 'f' ||
+			 optopt == 'a' || optopt == 'i' || optopt == 'c' ||
+			 optopt == 't' || optopt == 'n' || optopt == 'q')
 		   fprintf (stderr, "Option -%c requires an argument.\n", optopt);
 		 
+		 else if (optopt == 'K')
+		   fprintf (stderr, "Option --checkpoint requires an argument.\n");
+		 
 		 else if (isprint (optopt))
 		   fprintf (stderr, "Unknown option `-%c'.\n", optopt);
 		 
@@ -41,6 +41,11 @@ bool GetCommandLineInput ( std::string& inFilename, std::string& outFilename,
 		std::string& logFilename, std::string& reportFilename, std::string&
 		distillerName, 
 		bool& appendToLog, bool& verbose, bool& logToStdout, bool& saveLots, 
-		bool& saveReport, bool& savePaths, int argc, char* argv[] );
+		bool& saveReport, bool& savePaths, bool& streamPaths, 
+		bool& resumePaths, int& checkpointSeconds, int& numThreads, 
+		std::string& edgeBuilderName, std::string& pathLayoutName, 
+		std::string& ssspEngineName, std::string& vertexOrderName,
+		std::string& queryFilename, int& indexBlockSize, int& footprintRadius, int& tileSize, 
+		int argc, char* argv[] );
 
 #endif